@@ -8,7 +8,7 @@
     	"OTHER_CFLAGS": ["-DMODELDIR=\"<!(pkg-config --variable=modeldir pocketsphinx)\"", "<!(pkg-config --cflags pocketsphinx sphinxbase)"],
     	"OTHER_LDFLAGS": ["<!(pkg-config --libs pocketsphinx sphinxbase)"],
       },
-      "sources": [ "src/Factory.cpp", "src/Recognizer.cpp" ]
+      "sources": [ "src/Factory.cpp", "src/Recognizer.cpp", "src/Streaming.cpp", "src/FileDecoding.cpp", "src/MultiChannel.cpp", "src/Confidence.cpp", "src/Alignment.cpp", "src/ModelConversion.cpp", "src/Tracing.cpp", "src/DecoderQueue.cpp", "src/EndpointDetector.cpp", "src/JobPool.cpp", "src/AddonData.cpp", "src/EventSink.cpp", "src/AudioFile.cpp", "src/SharedModels.cpp", "src/Rescorer.cpp", "src/ModelCache.cpp", "src/KeywordList.cpp", "src/PruningController.cpp", "src/Governor.cpp", "src/Hibernation.cpp", "src/Tracer.cpp", "src/SessionLog.cpp", "src/SessionReplay.cpp", "src/MemoryTracker.cpp" ]
     }
   ]
 }
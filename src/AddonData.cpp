@@ -0,0 +1,59 @@
+#include "AddonData.h"
+#include "Recognizer.h"
+
+using namespace v8;
+using namespace std;
+
+AddonData::AddonData(Isolate* isolate) : isolate(isolate), closing(false),
+	// Free the state together with the environment (main thread or worker),
+	// the hook finishes asynchronously so open handles can be closed first
+	cleanupHook(node::AddEnvironmentCleanupHook(isolate, Cleanup, this)), pending(0), done(NULL), doneArg(NULL) {
+	loop = node::GetCurrentEventLoop(isolate);
+}
+
+AddonData::~AddonData() {
+	recognizerConstructor.Reset();
+	for(set<Recognizer*>::iterator it = recognizers.begin(); it != recognizers.end(); ++it) {
+		(*it)->addon = NULL;
+	}
+}
+
+AddonData* AddonData::Create(Isolate* isolate) {
+	return new AddonData(isolate);
+}
+
+AddonData* AddonData::From(Local<Value> data) {
+	return reinterpret_cast<AddonData*>(Local<v8::External>::Cast(data)->Value());
+}
+
+Local<v8::External> AddonData::External() {
+	return v8::External::New(isolate, this);
+}
+
+void AddonData::Hold() {
+	pending++;
+}
+
+void AddonData::Release() {
+	if(--pending > 0 || !closing)
+		return;
+
+	void (*finished)(void*) = done;
+	void* finishedArg = doneArg;
+	delete this;
+	finished(finishedArg);
+}
+
+void AddonData::Cleanup(void* arg, void (*done)(void*), void* doneArg) {
+	AddonData* addon = reinterpret_cast<AddonData*>(arg);
+	addon->closing = true;
+	addon->done = done;
+	addon->doneArg = doneArg;
+
+	addon->Hold();
+	addon->eventSink.Close(addon);
+	for(set<Recognizer*>::iterator it = addon->recognizers.begin(); it != addon->recognizers.end(); ++it) {
+		Recognizer::Teardown(*it);
+	}
+	addon->Release();
+}
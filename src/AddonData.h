@@ -0,0 +1,54 @@
+#ifndef ADDONDATA_H
+#define ADDONDATA_H
+
+#include <uv.h>
+#include <v8.h>
+#include <node.h>
+
+#include "EventSink.h"
+#include "JobPool.h"
+
+#include <set>
+
+class Recognizer;
+
+// State of the addon for one isolate, so the module can be loaded by several worker_threads
+class AddonData
+{
+public:
+	static AddonData* Create(v8::Isolate* isolate);
+	static AddonData* From(v8::Local<v8::Value> data);
+
+	v8::Local<v8::External> External();
+
+	v8::Isolate* isolate;
+	uv_loop_t* loop;
+
+	v8::Persistent<v8::Function> recognizerConstructor;
+	JobPool jobPool;
+	EventSink eventSink;
+
+	// Set once the environment is torn down, no JS may run after that
+	bool closing;
+
+	// Recognizers of this environment, the wrappers may be finalized after the state is gone
+	std::set<Recognizer*> recognizers;
+
+	// Handles and requests that still point at this state; it is freed after the last one, so every
+	// queued job holds it and the state outlives an environment that shuts down while the job runs
+	void Hold();
+	void Release();
+
+private:
+	explicit AddonData(v8::Isolate* isolate);
+	~AddonData();
+
+	static void Cleanup(void* arg, void (*done)(void*), void* doneArg);
+
+	node::AsyncCleanupHookHandle cleanupHook;
+	int pending;
+	void (*done)(void*);
+	void* doneArg;
+};
+
+#endif
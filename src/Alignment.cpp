@@ -0,0 +1,296 @@
+#include <node.h>
+#include <sstream>
+#include "Recognizer.h"
+
+using namespace v8;
+using namespace std;
+
+void Recognizer::Align(const FunctionCallbackInfo<Value>& args) {
+	Isolate* isolate = args.GetIsolate();
+	HandleScope scope(isolate);
+	Local<Context> context = isolate->GetCurrentContext();
+	Recognizer* instance = node::ObjectWrap::Unwrap<Recognizer>(args.Holder());
+
+	if(!Ready(instance, isolate)) {
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	if(args.Length() < 2) {
+		Recognizer::TypeError(instance, isolate, "Incorrect number of arguments, expected pairs and callback");
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	Local<Value> options = args.Length() >= 3 ? args[1] : Local<Value>::Cast(Undefined(isolate));
+	Local<Value> callback = args[args.Length() >= 3 ? 2 : 1];
+
+	if(!args[0]->IsArray() || !callback->IsFunction() || !(options->IsUndefined() || options->IsObject())) {
+		Recognizer::TypeError(instance, isolate, "Expected pairs to be an array, options to be an object and callback to be a function");
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	if(instance->processing) {
+		Recognizer::Error(instance, isolate, "Stop the recognizer before aligning");
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	uint32_t concurrency = 4;
+	bool silence = true;
+	if(options->IsObject()) {
+		Local<Value> value = options.As<Object>()->Get(context, NewString(isolate, "concurrency")).ToLocalChecked();
+		if(value->IsUint32() && value->Uint32Value(context).FromJust() > 0)
+			concurrency = value->Uint32Value(context).FromJust();
+		value = options.As<Object>()->Get(context, NewString(isolate, "silence")).ToLocalChecked();
+		if(value->IsBoolean())
+			silence = value->BooleanValue(isolate);
+	}
+
+	Local<Array> pairs = Local<Array>::Cast(args[0]);
+	Local<Array> buffers = Array::New(isolate, pairs->Length());
+	AlignBatch* batch = new AlignBatch();
+	batch->jobs.resize(pairs->Length());
+	for(uint32_t i = 0; i < pairs->Length(); i++) {
+		Local<Value> pair = pairs->Get(context, i).ToLocalChecked();
+		Local<Value> audio = pair->IsObject() ? pair.As<Object>()->Get(context, NewString(isolate, "audio")).ToLocalChecked() : Local<Value>::Cast(Undefined(isolate));
+		Local<Value> transcript = pair->IsObject() ? pair.As<Object>()->Get(context, NewString(isolate, "transcript")).ToLocalChecked() : Local<Value>::Cast(Undefined(isolate));
+		if(!node::Buffer::HasInstance(audio) || !transcript->IsString()) {
+			delete batch;
+			Recognizer::TypeError(instance, isolate, "Expected every pair to have an audio buffer and a transcript string");
+			args.GetReturnValue().Set(args.Holder());
+			return;
+		}
+
+		AlignJob& job = batch->jobs[i];
+		buffers->Set(context, i, audio).Check();
+		job.data = (const int16*) node::Buffer::Data(audio);
+		job.length = node::Buffer::Length(audio) / sizeof(int16);
+		job.error = NULL;
+
+		String::Utf8Value text(isolate, transcript);
+		istringstream words(*text);
+		string word;
+		while(words >> word) {
+			job.words.push_back(word);
+		}
+
+		// Unknown words would only fail later when the grammar is built
+		for(size_t j = 0; j < job.words.size() && job.error == NULL; j++) {
+			char* phones = ps_lookup_word(instance->ps, job.words[j].c_str());
+			if(phones == NULL) {
+				job.error = "Transcript contains a word that is not in the dictionary";
+			}
+			ckd_free(phones);
+		}
+		if(job.words.empty() && job.error == NULL) {
+			job.error = "Transcript is empty";
+		}
+	}
+
+	batch->request.data = batch;
+	batch->instance = instance;
+	batch->callback.Reset(isolate, Local<Function>::Cast(callback));
+	batch->buffers.Reset(isolate, buffers);
+	uv_mutex_init(&batch->lock);
+	batch->next = 0;
+	batch->pending = 0;
+	batch->silence = silence;
+	batch->error = NULL;
+	batch->frameRate = cmd_ln_int32_r(ps_get_config(instance->ps), "-frate");
+	batch->start = uv_hrtime();
+	batch->threads.resize(batch->jobs.size() < concurrency ? batch->jobs.size() : concurrency);
+
+	// The decoders belong to the batch until AlignAfter
+	instance->busy = true;
+	instance->Ref();
+	instance->addon->Hold();
+
+	uv_queue_work(instance->addon->loop, &batch->request, AlignPrepareWorker, (uv_after_work_cb)AlignPrepareAfter);
+
+	args.GetReturnValue().Set(args.Holder());
+}
+
+void Recognizer::AlignPrepareWorker(uv_work_t* request) {
+	AlignBatch* batch = reinterpret_cast<AlignBatch*>(request->data);
+	// Every thread aligns on a decoder of its own, the one of the Recognizer keeps its search and last utterance
+	batch->error = EnsureDecoders(batch->instance, batch->threads.size());
+}
+
+void Recognizer::AlignPrepareAfter(uv_work_t* request) {
+	AlignBatch* batch = reinterpret_cast<AlignBatch*>(request->data);
+	Recognizer* instance = batch->instance;
+	UpdateMemory(instance);
+
+	if(batch->error != NULL || batch->threads.empty()) {
+		FinishAlign(batch);
+		return;
+	}
+
+	batch->pending = int(batch->threads.size());
+	for(size_t i = 0; i < batch->threads.size(); i++) {
+		AlignThread& thread = batch->threads[i];
+		thread.request.data = &thread;
+		thread.batch = batch;
+		thread.ps = instance->channelDecoders[i];
+		uv_queue_work(instance->addon->loop, &thread.request, AlignWorker, (uv_after_work_cb)AlignAfter);
+	}
+}
+
+void Recognizer::AlignWorker(uv_work_t* request) {
+	AlignThread* thread = reinterpret_cast<AlignThread*>(request->data);
+	AlignBatch* batch = thread->batch;
+
+	// The alignment grammar replaces the search only for the batch
+	const char* active = ps_get_search(thread->ps);
+	string previous = active != NULL ? active : "";
+
+	for(;;) {
+		uv_mutex_lock(&batch->lock);
+		size_t index = batch->next++;
+		uv_mutex_unlock(&batch->lock);
+		if(index >= batch->jobs.size())
+			break;
+
+		AlignJob& job = batch->jobs[index];
+		if(job.error == NULL) {
+			TraceSpan span("decode", "align", batch->instance->traceId);
+			job.error = AlignItem(thread->ps, job, batch->silence);
+		}
+	}
+
+	if(!previous.empty()) {
+		ps_set_search(thread->ps, previous.c_str());
+	}
+}
+
+const char* Recognizer::AlignItem(ps_decoder_t* ps, AlignJob& job, bool silence) {
+	cmd_ln_t* config = ps_get_config(ps);
+
+	// One state per word boundary, every word leads to the next one
+	int32 words = int32(job.words.size());
+	fsg_model_t* fsg = fsg_model_init("_align", ps_get_logmath(ps), cmd_ln_float32_r(config, "-lw"), words + 1);
+	fsg->start_state = 0;
+	fsg->final_state = words;
+	for(int32 i = 0; i < words; i++) {
+		int32 wid = fsg_model_word_add(fsg, job.words[i].c_str());
+		fsg_model_trans_add(fsg, i, i + 1, 0, wid);
+	}
+	// Pauses are allowed at every boundary
+	if(silence) {
+		fsg_model_add_silence(fsg, "<sil>", -1, cmd_ln_float32_r(config, "-silprob"));
+	}
+
+	int result = ps_set_fsg(ps, "_align", fsg);
+	fsg_model_free(fsg);
+	if(result < 0 || ps_set_search(ps, "_align") < 0)
+		return "Failed to build alignment grammar";
+
+	if(ps_start_utt(ps) < 0)
+		return "Failed to start PocketSphinx processing";
+	if(ps_process_raw(ps, job.data, job.length, FALSE, TRUE) < 0) {
+		ps_end_utt(ps);
+		return "Failed to process audio data";
+	}
+	if(ps_end_utt(ps) < 0)
+		return "Failed to end PocketSphinx processing";
+
+	// Map the segments back to the transcript, skipping silences and fillers
+	size_t next = 0;
+	for(ps_seg_t* seg = ps_seg_iter(ps); seg != NULL; seg = ps_seg_next(seg)) {
+		if(next == job.words.size()) {
+			ps_seg_free(seg);
+			break;
+		}
+
+		// Alternative pronunciations are reported as word(2)
+		string word = ps_seg_word(seg);
+		size_t alternative = word.find('(');
+		if(alternative != string::npos && alternative > 0) {
+			word.erase(alternative);
+		}
+		if(word != job.words[next])
+			continue;
+
+		int32 start, end;
+		ps_seg_frames(seg, &start, &end);
+		job.start.push_back(start);
+		job.end.push_back(end);
+		next++;
+	}
+
+	if(next != job.words.size())
+		return "Audio does not match the transcript";
+
+	return NULL;
+}
+
+void Recognizer::AlignAfter(uv_work_t* request) {
+	AlignThread* thread = reinterpret_cast<AlignThread*>(request->data);
+	AlignBatch* batch = thread->batch;
+
+	if(--batch->pending == 0) {
+		FinishAlign(batch);
+	}
+}
+
+Local<Int32Array> Recognizer::FrameArray(Isolate* isolate, const vector<int32>& frames) {
+	// Node copies into memory of its own, no access to the backing store needed
+	Local<Uint8Array> bytes = node::Buffer::Copy(isolate, reinterpret_cast<const char*>(frames.data()), frames.size() * sizeof(int32)).ToLocalChecked().As<Uint8Array>();
+	return Int32Array::New(bytes->Buffer(), bytes->ByteOffset(), frames.size());
+}
+
+void Recognizer::FinishAlign(AlignBatch* batch) {
+	Recognizer* instance = batch->instance;
+	AddonData* addon = instance->addon;
+	Isolate* isolate = addon->isolate;
+	HandleScope scope(isolate);
+	Local<Context> context = isolate->GetCurrentContext();
+
+	instance->busy = false;
+
+	Local<Function> cb = Local<Function>::New(isolate, batch->callback);
+	if(batch->error != NULL) {
+		Local<Value> argv[1] = { Exception::Error(NewString(isolate, batch->error)) };
+		CallFunction(isolate, cb, 1, argv);
+	} else {
+		Local<Array> results = Array::New(isolate, int(batch->jobs.size()));
+		for(size_t i = 0; i < batch->jobs.size(); i++) {
+			AlignJob& job = batch->jobs[i];
+			Local<Object> result = Object::New(isolate);
+			if(job.error != NULL) {
+				result->Set(context, NewString(isolate, "error"), NewString(isolate, job.error)).Check();
+			} else {
+				// Frames as typed arrays, batches of long transcripts create no object per word
+				size_t count = job.words.size();
+
+				Local<Array> words = Array::New(isolate, int(count));
+				for(size_t j = 0; j < count; j++) {
+					words->Set(context, j, NewString(isolate, job.words[j].c_str())).Check();
+				}
+
+				result->Set(context, NewString(isolate, "error"), Null(isolate)).Check();
+				result->Set(context, NewString(isolate, "words"), words).Check();
+				result->Set(context, NewString(isolate, "start"), FrameArray(isolate, job.start)).Check();
+				result->Set(context, NewString(isolate, "end"), FrameArray(isolate, job.end)).Check();
+			}
+			results->Set(context, i, result).Check();
+		}
+
+		Local<Object> stats = Object::New(isolate);
+		stats->Set(context, NewString(isolate, "frameRate"), Integer::New(isolate, batch->frameRate)).Check();
+		stats->Set(context, NewString(isolate, "threads"), Integer::New(isolate, int(batch->threads.size()))).Check();
+		stats->Set(context, NewString(isolate, "decodeDuration"), Number::New(isolate, (uv_hrtime() - batch->start) / 1e6)).Check();
+
+		Local<Value> argv[3] = { Null(isolate), results, stats };
+		CallFunction(isolate, cb, 3, argv);
+	}
+
+	uv_mutex_destroy(&batch->lock);
+	batch->callback.Reset();
+	batch->buffers.Reset();
+	delete batch;
+	instance->Unref();
+	addon->Release();
+}
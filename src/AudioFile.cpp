@@ -0,0 +1,116 @@
+#include <string.h>
+#include "AudioFile.h"
+
+AudioFile::AudioFile() : file(NULL), error(NULL), wav(false), sampleRate(0), channels(1), remaining(0) {
+
+}
+
+AudioFile::~AudioFile() {
+	Close();
+}
+
+bool AudioFile::Open(const char* path, bool raw) {
+	Close();
+
+	file = fopen(path, "rb");
+	if(file == NULL) {
+		error = "Could not open audio file";
+		return false;
+	}
+
+	if(raw)
+		return true;
+
+	char riff[4];
+	if(fread(riff, 1, 4, file) == 4 && memcmp(riff, "RIFF", 4) == 0)
+		return ParseWav();
+
+	// No header, decode the file as is
+	rewind(file);
+	return true;
+}
+
+void AudioFile::Close() {
+	if(file != NULL)
+		fclose(file);
+	file = NULL;
+	wav = false;
+	remaining = 0;
+}
+
+size_t AudioFile::Read(int16* buffer, size_t samples) {
+	if(file == NULL)
+		return 0;
+
+	size_t bytes = samples * sizeof(int16);
+	if(wav && bytes > remaining)
+		bytes = remaining;
+
+	size_t read = fread(buffer, sizeof(int16), bytes / sizeof(int16), file);
+	if(wav)
+		remaining -= read * sizeof(int16);
+
+	return read;
+}
+
+bool AudioFile::ParseWav() {
+	uint32 size;
+	char id[4];
+
+	// RIFF size and WAVE tag
+	if(!ReadUint32(&size) || fread(id, 1, 4, file) != 4 || memcmp(id, "WAVE", 4) != 0) {
+		error = "Invalid WAV header";
+		return false;
+	}
+
+	bool hasFormat = false;
+	while(fread(id, 1, 4, file) == 4 && ReadUint32(&size)) {
+		if(memcmp(id, "fmt ", 4) == 0) {
+			uint32 format, fileChannels, rate, byteRate, blockAlign, bits;
+			if(size < 16 ||
+				!ReadUint16(&format) || !ReadUint16(&fileChannels) || !ReadUint32(&rate) ||
+				!ReadUint32(&byteRate) || !ReadUint16(&blockAlign) || !ReadUint16(&bits)) {
+				error = "Invalid WAV format chunk";
+				return false;
+			}
+			// PCM or WAVE_FORMAT_EXTENSIBLE
+			if((format != 1 && format != 0xFFFE) || bits != 16) {
+				error = "Only 16 bit PCM WAV files are supported";
+				return false;
+			}
+			sampleRate = int32(rate);
+			channels = int32(fileChannels);
+			hasFormat = true;
+			// Skip the rest of the chunk including padding
+			if(fseek(file, long(size - 16 + (size & 1)), SEEK_CUR) != 0)
+				break;
+		} else if(memcmp(id, "data", 4) == 0) {
+			if(!hasFormat)
+				break;
+			wav = true;
+			remaining = size;
+			return true;
+		} else if(fseek(file, long(size + (size & 1)), SEEK_CUR) != 0) {
+			break;
+		}
+	}
+
+	error = "WAV file has no data chunk";
+	return false;
+}
+
+bool AudioFile::ReadUint32(uint32* value) {
+	unsigned char bytes[4];
+	if(fread(bytes, 1, 4, file) != 4)
+		return false;
+	*value = uint32(bytes[0]) | (uint32(bytes[1]) << 8) | (uint32(bytes[2]) << 16) | (uint32(bytes[3]) << 24);
+	return true;
+}
+
+bool AudioFile::ReadUint16(uint32* value) {
+	unsigned char bytes[2];
+	if(fread(bytes, 1, 2, file) != 2)
+		return false;
+	*value = uint32(bytes[0]) | (uint32(bytes[1]) << 8);
+	return true;
+}
@@ -0,0 +1,41 @@
+#ifndef AUDIOFILE_H
+#define AUDIOFILE_H
+
+#include <stdio.h>
+#include <pocketsphinx.h>
+
+// Reads 16 bit PCM from WAV or headerless files in chunks, without V8 so it can run on pool threads
+class AudioFile
+{
+public:
+	AudioFile();
+	~AudioFile();
+
+	// Parses the WAV header unless raw is set or the file has no RIFF header
+	bool Open(const char* path, bool raw);
+	void Close();
+
+	// Returns the number of samples read, 0 at the end of the data
+	size_t Read(int16* buffer, size_t samples);
+
+	const char* Error() const { return error; }
+
+	bool IsWav() const { return wav; }
+	int32 SampleRate() const { return sampleRate; }
+	int32 Channels() const { return channels; }
+
+private:
+	bool ParseWav();
+	bool ReadUint32(uint32* value);
+	bool ReadUint16(uint32* value);
+
+	FILE* file;
+	const char* error;
+	bool wav;
+	int32 sampleRate;
+	int32 channels;
+	// Bytes left in the data chunk, only used for WAV files
+	size_t remaining;
+};
+
+#endif
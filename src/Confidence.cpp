@@ -0,0 +1,87 @@
+#include <node.h>
+#include "Recognizer.h"
+
+using namespace v8;
+using namespace std;
+
+void Recognizer::Confidence(const FunctionCallbackInfo<Value>& args) {
+	Isolate* isolate = args.GetIsolate();
+	HandleScope scope(isolate);
+	Recognizer* instance = node::ObjectWrap::Unwrap<Recognizer>(args.Holder());
+
+	if(!Ready(instance, isolate)) {
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	if(args.Length() < 1 || !args[0]->IsFunction()) {
+		Recognizer::TypeError(instance, isolate, "Expected callback to be a function");
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	if(instance->processing) {
+		Recognizer::Error(instance, isolate, "Stop the recognizer before asking for confidence");
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	ConfidenceData* data = new ConfidenceData();
+	data->request.data = data;
+	data->instance = instance;
+	data->callback.Reset(isolate, Local<Function>::Cast(args[0]));
+	data->prob = 0;
+	data->frameRate = cmd_ln_int32_r(ps_get_config(instance->ps), "-frate");
+
+	// The decoder belongs to the job until ConfidenceAfter, so the utterance stays the last one
+	instance->busy = true;
+	instance->Ref();
+	instance->addon->Hold();
+
+	uv_queue_work(instance->addon->loop, &data->request, ConfidenceWorker, (uv_after_work_cb)ConfidenceAfter);
+
+	args.GetReturnValue().Set(args.Holder());
+}
+
+void Recognizer::ConfidenceWorker(uv_work_t* request) {
+	ConfidenceData* data = reinterpret_cast<ConfidenceData*>(request->data);
+	ps_decoder_t* ps = data->instance->ps;
+	TraceSpan span("decode", "confidence", data->instance->traceId);
+
+	int32 score;
+	const char* hyp = ps_get_hyp(ps, &score);
+	if(hyp == NULL)
+		return;
+	data->hyp.assign(hyp);
+
+	// Builds the lattice and runs forward-backward over it, the segments then carry word posteriors
+	int32 prob = ps_get_prob(ps);
+	data->prob = logmath_exp(ps_get_logmath(ps), prob);
+	CollectSegments(ps, data->segments);
+}
+
+void Recognizer::ConfidenceAfter(uv_work_t* request) {
+	ConfidenceData* data = reinterpret_cast<ConfidenceData*>(request->data);
+	Recognizer* instance = data->instance;
+	AddonData* addon = instance->addon;
+	Isolate* isolate = addon->isolate;
+	HandleScope scope(isolate);
+	Local<Context> context = isolate->GetCurrentContext();
+
+	instance->busy = false;
+
+	Local<Object> result = Object::New(isolate);
+	result->Set(context, NewString(isolate, "hyp"), NewString(isolate, data->hyp.c_str())).Check();
+	result->Set(context, NewString(isolate, "prob"), Number::New(isolate, data->prob)).Check();
+	result->Set(context, NewString(isolate, "words"), SegmentArray(isolate, data->segments)).Check();
+	result->Set(context, NewString(isolate, "frameRate"), Integer::New(isolate, data->frameRate)).Check();
+
+	Local<Function> cb = Local<Function>::New(isolate, data->callback);
+	Local<Value> argv[2] = { Null(isolate), result };
+	CallFunction(isolate, cb, 2, argv);
+
+	data->callback.Reset();
+	delete data;
+	instance->Unref();
+	addon->Release();
+}
@@ -0,0 +1,70 @@
+#include "DecoderQueue.h"
+#include "Recognizer.h"
+
+DecoderQueue::DecoderQueue() : instance(NULL), loop(NULL), running(NULL), finishing(false), holding(false) {
+
+}
+
+void DecoderQueue::Init(Recognizer* instance, uv_loop_t* loop) {
+	this->instance = instance;
+	this->loop = loop;
+}
+
+void DecoderQueue::Push(DecoderJob* job) {
+	job->request.data = job;
+	job->instance = instance;
+	jobs.push_back(job);
+
+	if(!holding) {
+		holding = true;
+		instance->Ref();
+		// Queued work keeps the addon state alive while the environment shuts down
+		instance->addon->Hold();
+	}
+
+	// Pushed from the after callback of the running job, Next picks it up once that returned
+	if(running == NULL)
+		Next();
+}
+
+void DecoderQueue::Work(uv_work_t* request) {
+	DecoderJob* job = reinterpret_cast<DecoderJob*>(request->data);
+	job->work(job);
+}
+
+void DecoderQueue::After(uv_work_t* request, int status) {
+	DecoderJob* job = reinterpret_cast<DecoderJob*>(request->data);
+	DecoderQueue* queue = &job->instance->queue;
+	queue->finishing = true;
+	job->after(job);
+	queue->finishing = false;
+	queue->running = NULL;
+	queue->Next();
+}
+
+void DecoderQueue::Next() {
+	while(running == NULL && !jobs.empty()) {
+		DecoderJob* job = jobs.front();
+		jobs.pop_front();
+		running = job;
+
+		if(job->work != NULL) {
+			uv_queue_work(loop, &job->request, Work, After);
+			return;
+		}
+
+		// Nothing to do off the loop thread, the decoder is idle between two jobs
+		finishing = true;
+		job->after(job);
+		finishing = false;
+		running = NULL;
+	}
+
+	// Last thing to do, the Recognizer may be collected from here on
+	if(running == NULL && holding) {
+		AddonData* addon = instance->addon;
+		holding = false;
+		instance->Unref();
+		addon->Release();
+	}
+}
@@ -0,0 +1,52 @@
+#ifndef DECODERQUEUE_H
+#define DECODERQUEUE_H
+
+#include <uv.h>
+
+#include <deque>
+
+class Recognizer;
+
+// Something that needs the decoder of a Recognizer, like one written chunk or a deferred stop()
+typedef struct DecoderJob {
+	uv_work_t request;
+	Recognizer* instance;
+	// The struct that embeds the job
+	void* data;
+	// Runs on a libuv pool thread without V8, NULL for jobs that only run on the loop thread
+	void (*work)(struct DecoderJob* job);
+	// Runs on the loop thread after work, the job belongs to it from then on
+	void (*after)(struct DecoderJob* job);
+} DecoderJob;
+
+// Runs the jobs of one Recognizer one after the other in the order they were pushed,
+// so two writes never call into the same decoder at once
+class DecoderQueue
+{
+public:
+	DecoderQueue();
+
+	void Init(Recognizer* instance, uv_loop_t* loop);
+	void Push(DecoderJob* job);
+
+	// Whether nothing is queued or running, only then the decoder may be used directly. The after
+	// callback of the last job counts as idle, so its event handlers can call start() or reconfig()
+	bool Idle() const { return (running == NULL || finishing) && jobs.empty(); }
+	size_t Size() const { return jobs.size() + (running != NULL ? 1 : 0); }
+
+private:
+	static void Work(uv_work_t* request);
+	static void After(uv_work_t* request, int status);
+	void Next();
+
+	Recognizer* instance;
+	uv_loop_t* loop;
+	std::deque<DecoderJob*> jobs;
+	DecoderJob* running;
+	// The running job is in its after callback, nothing uses the decoder off the loop thread
+	bool finishing;
+	// The queue keeps the Recognizer alive while it is not idle
+	bool holding;
+};
+
+#endif
@@ -0,0 +1,68 @@
+#include "EndpointDetector.h"
+
+EndpointDetector::EndpointDetector() : enabled(false), trailingSilenceMs(500), minSpeechMs(100), maxUtteranceMs(0),
+	msPerFrame(0), prespeech(0), postspeech(0), speechStart(-1), speechEnd(-1), inSpeech(false) {
+
+}
+
+void EndpointDetector::Enable(double trailingSilence, double minSpeech, double maxUtterance) {
+	enabled = true;
+	trailingSilenceMs = trailingSilence;
+	minSpeechMs = minSpeech;
+	maxUtteranceMs = maxUtterance;
+}
+
+void EndpointDetector::Disable() {
+	enabled = false;
+}
+
+void EndpointDetector::Reset(ps_decoder_t* ps) {
+	cmd_ln_t* config = ps_get_config(ps);
+	int32 frameRate = cmd_ln_int32_r(config, "-frate");
+	msPerFrame = frameRate > 0 ? 1000.0 / frameRate : 0;
+	prespeech = cmd_ln_int32_r(config, "-vad_prespeech");
+	postspeech = cmd_ln_int32_r(config, "-vad_postspeech");
+
+	speechStart = -1;
+	speechEnd = -1;
+	inSpeech = false;
+}
+
+bool EndpointDetector::Update(int32 frames, bool speech, const char** reason, double* latency) {
+	if(msPerFrame <= 0)
+		return false;
+
+	if(speech) {
+		// The detector only reports speech after -vad_prespeech frames of it
+		if(speechStart < 0) {
+			speechStart = frames - prespeech > 0 ? frames - prespeech : 0;
+		}
+		speechEnd = frames - 1;
+	} else if(inSpeech) {
+		// It also keeps reporting speech for -vad_postspeech frames after the voice stopped
+		// and left speech somewhere in this chunk, assume the end so it never fires early
+		int32 end = frames - 1 - postspeech;
+		speechEnd = end > speechStart ? end : speechStart;
+	}
+	inSpeech = speech;
+
+	if(speechEnd >= 0 && !inSpeech) {
+		double spoken = (speechEnd - speechStart + 1) * msPerFrame;
+		double trailing = (frames - speechEnd - 1) * msPerFrame;
+		if(spoken >= minSpeechMs && trailing >= trailingSilenceMs) {
+			*reason = "silence";
+			// How much audio was decoded after the rule could have fired
+			*latency = trailing - trailingSilenceMs;
+			return true;
+		}
+	}
+
+	double utterance = frames * msPerFrame;
+	if(maxUtteranceMs > 0 && utterance >= maxUtteranceMs) {
+		*reason = "maxUtterance";
+		*latency = utterance - maxUtteranceMs;
+		return true;
+	}
+
+	return false;
+}
@@ -0,0 +1,40 @@
+#ifndef ENDPOINTDETECTOR_H
+#define ENDPOINTDETECTOR_H
+
+#include <pocketsphinx.h>
+
+// Ends utterances on frame counts, fed once per decoded chunk with the state of the
+// voice activity detector so the cost does not grow with the utterance
+class EndpointDetector
+{
+public:
+	EndpointDetector();
+
+	// Thresholds in milliseconds of decoded audio
+	void Enable(double trailingSilence, double minSpeech, double maxUtterance);
+	void Disable();
+	bool Enabled() const { return enabled; }
+
+	// Takes the frame rate and detector delays of the decoder, called when an utterance starts
+	void Reset(ps_decoder_t* ps);
+
+	// Frames decoded so far and whether the detector reports speech after them
+	bool Update(int32 frames, bool inSpeech, const char** reason, double* latency);
+
+private:
+	bool enabled;
+	double trailingSilenceMs;
+	double minSpeechMs;
+	double maxUtteranceMs;
+
+	double msPerFrame;
+	int32 prespeech;
+	int32 postspeech;
+
+	// First and last frame the detector counted as speech, -1 before any speech
+	int32 speechStart;
+	int32 speechEnd;
+	bool inSpeech;
+};
+
+#endif
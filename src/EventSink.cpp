@@ -0,0 +1,132 @@
+#include "EventSink.h"
+#include "Recognizer.h"
+
+using namespace v8;
+
+Local<Value> EventArg::ToValue(Isolate* isolate) const {
+	switch(type) {
+	case STRING:
+		return NewString(isolate, str.c_str());
+	case NUMBER:
+		return Number::New(isolate, num);
+	case ERROR:
+		return Exception::Error(NewString(isolate, str.c_str()));
+	case TYPEERROR:
+		return Exception::TypeError(NewString(isolate, str.c_str()));
+	default:
+		return Null(isolate);
+	}
+}
+
+EventSink::EventSink() : isolate(NULL), async(NULL), count(0) {
+
+}
+
+EventSink::~EventSink() {
+	callback.Reset();
+}
+
+void EventSink::SetCallback(Isolate* isolate, uv_loop_t* loop, Local<Function> cb) {
+	this->isolate = isolate;
+	callback.Reset(isolate, cb);
+
+	if(async == NULL) {
+		async = new uv_async_t();
+		uv_async_init(loop, async, AsyncFlush);
+		async->data = this;
+		// Only pending events should keep the loop alive
+		uv_unref(reinterpret_cast<uv_handle_t*>(async));
+	}
+}
+
+void EventSink::Clear(Isolate* isolate) {
+	// Hand out what is still queued before the sink goes away
+	Flush(isolate);
+	callback.Reset();
+}
+
+void EventSink::Push(Recognizer* instance, const char* name, int argc, const EventArg* argv) {
+	if(count == queue.size())
+		queue.push_back(QueuedEvent());
+
+	QueuedEvent& event = queue[count++];
+	event.instance = instance;
+	event.name = name;
+	event.argc = argc;
+	for(int i = 0; i < argc; i++)
+		event.argv[i] = argv[i];
+
+	// The JS object has to survive until it was handed to the sink
+	instance->Ref();
+
+	if(count == 1) {
+		uv_ref(reinterpret_cast<uv_handle_t*>(async));
+		uv_async_send(async);
+	}
+}
+
+void EventSink::Flush(Isolate* isolate) {
+	if(count == 0)
+		return;
+
+	HandleScope scope(isolate);
+	Local<Context> context = isolate->GetCurrentContext();
+
+	// Events emitted from inside the sink go to the next tick
+	std::vector<QueuedEvent> events;
+	events.swap(queue);
+	size_t length = count;
+	count = 0;
+	uv_unref(reinterpret_cast<uv_handle_t*>(async));
+
+	Local<Array> batch = Array::New(isolate, int(length));
+	for(size_t i = 0; i < length; i++) {
+		QueuedEvent& event = events[i];
+
+		// Every entry looks like [recognizer, event, ...callback arguments]
+		Local<Array> entry = Array::New(isolate, event.argc + 2);
+		entry->Set(context, 0, event.instance->handle(isolate)).Check();
+		entry->Set(context, 1, NewString(isolate, event.name)).Check();
+		for(int j = 0; j < event.argc; j++) {
+			entry->Set(context, j + 2, event.argv[j].ToValue(isolate)).Check();
+		}
+		batch->Set(context, i, entry).Check();
+
+		// The batch holds the object now
+		event.instance->Unref();
+	}
+
+	// Keep the allocated event storage when nothing was queued meanwhile
+	if(queue.empty())
+		queue.swap(events);
+
+	if(!callback.IsEmpty()) {
+		Local<Value> argv[1] = { batch };
+		TraceSpan span("js", "eventSink", 0);
+		Local<Function> cb = Local<Function>::New(isolate, callback);
+		CallFunction(isolate, cb, 1, argv);
+	}
+}
+
+void EventSink::AsyncFlush(uv_async_t* handle) {
+	EventSink* sink = reinterpret_cast<EventSink*>(handle->data);
+	sink->Flush(sink->isolate);
+}
+
+void EventSink::Close(AddonData* addon) {
+	callback.Reset();
+	count = 0;
+	if(async == NULL)
+		return;
+
+	addon->Hold();
+	async->data = addon;
+	uv_close(reinterpret_cast<uv_handle_t*>(async), AsyncClose);
+	async = NULL;
+}
+
+void EventSink::AsyncClose(uv_handle_t* handle) {
+	AddonData* addon = reinterpret_cast<AddonData*>(handle->data);
+	delete reinterpret_cast<uv_async_t*>(handle);
+	addon->Release();
+}
@@ -0,0 +1,71 @@
+#ifndef EVENTSINK_H
+#define EVENTSINK_H
+
+#include <uv.h>
+#include <v8.h>
+
+#include <string>
+#include <vector>
+
+class AddonData;
+class Recognizer;
+
+// Native copy of one callback argument, so events can be queued without V8 handles
+typedef struct EventArg {
+	// Errors keep their message and become Error or TypeError objects on delivery
+	enum { NUL, STRING, NUMBER, ERROR, TYPEERROR } type;
+	std::string str;
+	double num;
+
+	void SetNull() { type = NUL; }
+	void SetString(const char* value) { type = STRING; str.assign(value ? value : ""); }
+	void SetNumber(double value) { type = NUMBER; num = value; }
+	void SetError(const char* message) { type = ERROR; str.assign(message); }
+	void SetTypeError(const char* message) { type = TYPEERROR; str.assign(message); }
+
+	v8::Local<v8::Value> ToValue(v8::Isolate* isolate) const;
+} EventArg;
+
+#define EVENT_MAX_ARGS 6
+
+typedef struct QueuedEvent {
+	Recognizer* instance;
+	const char* name;
+	int argc;
+	EventArg argv[EVENT_MAX_ARGS];
+} QueuedEvent;
+
+// Collects the events of all Recognizers of an isolate and delivers them with one call per loop tick
+class EventSink
+{
+public:
+	EventSink();
+	~EventSink();
+
+	bool Enabled() const { return !callback.IsEmpty(); }
+
+	void SetCallback(v8::Isolate* isolate, uv_loop_t* loop, v8::Local<v8::Function> cb);
+	void Clear(v8::Isolate* isolate);
+
+	void Push(Recognizer* instance, const char* name, int argc, const EventArg* argv);
+	void Flush(v8::Isolate* isolate);
+
+	// Closes the handle when the environment goes away, the addon is released once it is closed
+	void Close(AddonData* addon);
+
+	size_t Pending() const { return count; }
+
+private:
+	static void AsyncFlush(uv_async_t* handle);
+	static void AsyncClose(uv_handle_t* handle);
+
+	v8::Persistent<v8::Function> callback;
+	v8::Isolate* isolate;
+	uv_async_t* async;
+
+	// Events are appended to a reused vector, count is the number of valid entries
+	std::vector<QueuedEvent> queue;
+	size_t count;
+};
+
+#endif
@@ -3,10 +3,7 @@
 
 using namespace v8;
 
-extern "C" {
-	void InitAll(Handle<Object> exports){
-		Recognizer::Init(exports);
-	}
-
-	NODE_MODULE(PocketSphinx, InitAll);
+// Context aware so the module can be required from several worker_threads
+NODE_MODULE_INIT() {
+	Recognizer::Init(exports, context);
 }
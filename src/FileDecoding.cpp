@@ -0,0 +1,203 @@
+#include <node.h>
+#include "Recognizer.h"
+#include "AudioFile.h"
+
+using namespace v8;
+using namespace std;
+
+void Recognizer::DecodeFile(const FunctionCallbackInfo<Value>& args) {
+	Isolate* isolate = args.GetIsolate();
+	HandleScope scope(isolate);
+	Local<Context> context = isolate->GetCurrentContext();
+	Recognizer* instance = node::ObjectWrap::Unwrap<Recognizer>(args.Holder());
+
+	if(!Ready(instance, isolate)) {
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	if(args.Length() < 2) {
+		Recognizer::TypeError(instance, isolate, "Incorrect number of arguments, expected path and callback");
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	Local<Value> options = args.Length() >= 3 ? args[1] : Local<Value>::Cast(Undefined(isolate));
+	Local<Value> callback = args[args.Length() >= 3 ? 2 : 1];
+
+	if(!args[0]->IsString() || !callback->IsFunction() || !(options->IsUndefined() || options->IsObject())) {
+		Recognizer::TypeError(instance, isolate, "Expected path to be a string, options to be an object and callback to be a function");
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	if(instance->processing) {
+		Recognizer::Error(instance, isolate, "Stop the recognizer before decoding a file");
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	bool raw = false;
+	double maxUtterance = 30000;
+	if(options->IsObject()) {
+		Local<Value> value = options.As<Object>()->Get(context, NewString(isolate, "raw")).ToLocalChecked();
+		raw = value->IsBoolean() && value->BooleanValue(isolate);
+		value = options.As<Object>()->Get(context, NewString(isolate, "maxUtterance")).ToLocalChecked();
+		if(!value->IsUndefined() && (!value->IsNumber() || value->NumberValue(context).FromJust() < 100)) {
+			Recognizer::TypeError(instance, isolate, "Expected maxUtterance to be at least 100 milliseconds");
+			args.GetReturnValue().Set(args.Holder());
+			return;
+		}
+		if(!value->IsUndefined())
+			maxUtterance = value->NumberValue(context).FromJust();
+	}
+
+	DecodeFileData* data = new DecodeFileData();
+	data->request.data = data;
+	data->instance = instance;
+	data->callback.Reset(isolate, Local<Function>::Cast(callback));
+	data->path = *String::Utf8Value(isolate, args[0]);
+	data->raw = raw;
+	data->frameRate = cmd_ln_int32_r(ps_get_config(instance->ps), "-frate");
+	data->maxFrames = int32(maxUtterance * data->frameRate / 1000);
+	data->error = NULL;
+	data->score = 0;
+	data->offset = 0;
+	data->utterances = 0;
+	data->peakFrames = 0;
+	data->audioDuration = 0;
+	data->decodeDuration = 0;
+
+	// The decoder belongs to the job until DecodeFileAfter
+	instance->busy = true;
+	instance->Ref();
+	instance->addon->Hold();
+
+	uv_queue_work(instance->addon->loop, &data->request, DecodeFileWorker, (uv_after_work_cb)DecodeFileAfter);
+
+	args.GetReturnValue().Set(args.Holder());
+}
+
+void Recognizer::DecodeFileWorker(uv_work_t* request) {
+	DecodeFileData* data = reinterpret_cast<DecodeFileData*>(request->data);
+	ps_decoder_t* ps = data->instance->ps;
+	TraceSpan span("decode", "decodeFile", data->instance->traceId);
+
+	AudioFile file;
+	if(!file.Open(data->path.c_str(), data->raw)) {
+		data->error = file.Error();
+		return;
+	}
+
+	float32 sampleRate = cmd_ln_float32_r(ps_get_config(ps), "-samprate");
+	if(file.IsWav() && (file.Channels() != 1 || file.SampleRate() != int32(sampleRate))) {
+		data->error = "WAV file has to be mono and match -samprate";
+		return;
+	}
+
+	uint64_t start = uv_hrtime();
+
+	if(ps_start_utt(ps) < 0) {
+		data->error = "Failed to start PocketSphinx processing";
+		return;
+	}
+
+	// Stream the file through a fixed buffer and cut it into utterances at the pauses, or after
+	// maxFrames of speech without one, so neither the buffer nor the search grow with the file
+	int16 buffer[4096];
+	size_t samples = 0;
+	size_t read;
+	bool inSpeech = false;
+	while((read = file.Read(buffer, 4096)) > 0) {
+		if(ps_process_raw(ps, buffer, read, FALSE, FALSE) < 0) {
+			ps_end_utt(ps);
+			data->error = "Failed to process audio data";
+			return;
+		}
+		samples += read;
+
+		bool speech = ps_get_in_speech(ps) != 0;
+		bool pause = inSpeech && !speech;
+		inSpeech = speech;
+		if(!pause && ps_get_n_frames(ps) < data->maxFrames)
+			continue;
+
+		data->error = EndFileUtterance(ps, data);
+		if(data->error == NULL && ps_start_utt(ps) < 0)
+			data->error = "Failed to start PocketSphinx processing";
+		if(data->error != NULL)
+			return;
+		inSpeech = false;
+	}
+
+	data->error = EndFileUtterance(ps, data);
+	if(data->error != NULL)
+		return;
+
+	data->audioDuration = samples * 1000.0 / sampleRate;
+	data->decodeDuration = (uv_hrtime() - start) / 1e6;
+}
+
+const char* Recognizer::EndFileUtterance(ps_decoder_t* ps, DecodeFileData* data) {
+	if(ps_end_utt(ps) < 0)
+		return "Failed to end PocketSphinx processing";
+
+	int32 frames = ps_get_n_frames(ps);
+	int32 score;
+	const char* hyp = ps_get_hyp(ps, &score);
+	if(hyp != NULL && hyp[0] != '\0') {
+		if(!data->hyp.empty())
+			data->hyp += " ";
+		data->hyp += hyp;
+		data->score += score;
+	}
+
+	// Frames of the segments count from the start of the file
+	size_t first = data->segments.size();
+	CollectSegments(ps, data->segments);
+	for(size_t i = first; i < data->segments.size(); i++) {
+		data->segments[i].start += data->offset;
+		data->segments[i].end += data->offset;
+	}
+
+	data->offset += frames;
+	data->utterances++;
+	if(frames > data->peakFrames)
+		data->peakFrames = frames;
+	return NULL;
+}
+
+void Recognizer::DecodeFileAfter(uv_work_t* request) {
+	DecodeFileData* data = reinterpret_cast<DecodeFileData*>(request->data);
+	Recognizer* instance = data->instance;
+	AddonData* addon = instance->addon;
+	Isolate* isolate = addon->isolate;
+	HandleScope scope(isolate);
+	Local<Context> context = isolate->GetCurrentContext();
+
+	instance->busy = false;
+
+	Local<Function> cb = Local<Function>::New(isolate, data->callback);
+	if(data->error != NULL) {
+		Local<Value> argv[1] = { Exception::Error(NewString(isolate, data->error)) };
+		CallFunction(isolate, cb, 1, argv);
+	} else {
+		Local<Object> result = Object::New(isolate);
+		result->Set(context, NewString(isolate, "hyp"), NewString(isolate, data->hyp.c_str())).Check();
+		result->Set(context, NewString(isolate, "score"), Number::New(isolate, data->score)).Check();
+		result->Set(context, NewString(isolate, "segments"), SegmentArray(isolate, data->segments)).Check();
+		result->Set(context, NewString(isolate, "frameRate"), Integer::New(isolate, data->frameRate)).Check();
+		result->Set(context, NewString(isolate, "utterances"), Number::New(isolate, double(data->utterances))).Check();
+		result->Set(context, NewString(isolate, "peakFrames"), Integer::New(isolate, data->peakFrames)).Check();
+		result->Set(context, NewString(isolate, "audioDuration"), Number::New(isolate, data->audioDuration)).Check();
+		result->Set(context, NewString(isolate, "decodeDuration"), Number::New(isolate, data->decodeDuration)).Check();
+
+		Local<Value> argv[2] = { Null(isolate), result };
+		CallFunction(isolate, cb, 2, argv);
+	}
+
+	data->callback.Reset();
+	delete data;
+	instance->Unref();
+	addon->Release();
+}
@@ -0,0 +1,107 @@
+#include <uv.h>
+#include "Governor.h"
+
+static uv_once_t once = UV_ONCE_INIT;
+static uv_mutex_t lock;
+static GovernorStats state;
+
+void Governor::InitOnce() {
+	uv_mutex_init(&lock);
+	state.enabled = false;
+	state.backlog = 0;
+	state.maxBacklog = 0;
+	state.protectedPriority = 0;
+	state.streams = 0;
+	state.refused = 0;
+	state.dropped = 0;
+	state.late = 0;
+}
+
+void Governor::Configure(bool enabled, double maxBacklog, int protectedPriority) {
+	uv_once(&once, InitOnce);
+	uv_mutex_lock(&lock);
+	state.enabled = enabled;
+	state.maxBacklog = maxBacklog;
+	state.protectedPriority = protectedPriority;
+	uv_mutex_unlock(&lock);
+}
+
+GovernorStats Governor::Stats() {
+	uv_once(&once, InitOnce);
+	uv_mutex_lock(&lock);
+	GovernorStats stats = state;
+	uv_mutex_unlock(&lock);
+	return stats;
+}
+
+void Governor::Register(GovernorStream* stream) {
+	uv_once(&once, InitOnce);
+	stream->priority = 1;
+	stream->deadline = 0;
+	stream->backlog = 0;
+	uv_mutex_lock(&lock);
+	stream->registered = true;
+	state.streams++;
+	uv_mutex_unlock(&lock);
+}
+
+void Governor::Unregister(GovernorStream* stream) {
+	uv_mutex_lock(&lock);
+	if(stream->registered) {
+		stream->registered = false;
+		state.streams--;
+		state.backlog -= stream->backlog;
+		stream->backlog = 0;
+	}
+	uv_mutex_unlock(&lock);
+}
+
+bool Governor::Overloaded(GovernorStream* stream) {
+	return state.maxBacklog > 0 && state.backlog >= state.maxBacklog && stream->priority < state.protectedPriority;
+}
+
+bool Governor::AdmitSession(GovernorStream* stream) {
+	uv_mutex_lock(&lock);
+	bool admitted = !state.enabled || !Overloaded(stream);
+	if(!admitted)
+		state.refused++;
+	uv_mutex_unlock(&lock);
+	return admitted;
+}
+
+bool Governor::AdmitChunk(GovernorStream* stream, double duration) {
+	uv_mutex_lock(&lock);
+	bool admitted = true;
+	if(state.enabled) {
+		// Streams behind their deadline catch up by skipping audio, low priorities give way under overload
+		if(stream->deadline > 0 && stream->backlog > 0 && stream->backlog + duration > stream->deadline)
+			admitted = false;
+		else if(Overloaded(stream))
+			admitted = false;
+	}
+
+	if(admitted) {
+		stream->backlog += duration;
+		state.backlog += duration;
+	} else {
+		state.dropped++;
+	}
+	uv_mutex_unlock(&lock);
+	return admitted;
+}
+
+void Governor::Done(GovernorStream* stream, double duration) {
+	uv_mutex_lock(&lock);
+	// Unregistering took the backlog of the stream off already
+	if(stream->registered) {
+		stream->backlog -= duration;
+		state.backlog -= duration;
+	}
+	uv_mutex_unlock(&lock);
+}
+
+void Governor::Late() {
+	uv_mutex_lock(&lock);
+	state.late++;
+	uv_mutex_unlock(&lock);
+}
@@ -0,0 +1,54 @@
+#ifndef GOVERNOR_H
+#define GOVERNOR_H
+
+#include <stddef.h>
+
+// Quality of service settings and queued audio of one Recognizer
+typedef struct GovernorStream {
+	// Streams below the protected priority are shed under overload, 1 like the default protectedPriority
+	int priority;
+	// Milliseconds of its own audio the stream may have waiting to be decoded, further chunks are
+	// dropped so it catches up; 0 disables. The only meaning of deadline
+	double deadline;
+	// Milliseconds of audio written but not decoded yet
+	double backlog;
+	// Counted in streams until free() or the destructor, whichever comes first
+	bool registered;
+} GovernorStream;
+
+typedef struct GovernorStats {
+	bool enabled;
+	double backlog;
+	double maxBacklog;
+	int protectedPriority;
+	size_t streams;
+	size_t refused;
+	size_t dropped;
+	size_t late;
+} GovernorStats;
+
+// Process wide view of the decode backlog of all Recognizers, shared by all threads
+class Governor
+{
+public:
+	static void Configure(bool enabled, double maxBacklog, int protectedPriority);
+	static GovernorStats Stats();
+
+	static void Register(GovernorStream* stream);
+	// Does nothing for a stream that was unregistered already
+	static void Unregister(GovernorStream* stream);
+
+	// Whether a new utterance may start
+	static bool AdmitSession(GovernorStream* stream);
+	// Whether a chunk of the given duration should be decoded, accepted audio counts as backlog until Done.
+	// A chunk longer than the deadline is still taken when nothing of the stream waits
+	static bool AdmitChunk(GovernorStream* stream, double duration);
+	static void Done(GovernorStream* stream, double duration);
+	static void Late();
+
+private:
+	static void InitOnce();
+	static bool Overloaded(GovernorStream* stream);
+};
+
+#endif
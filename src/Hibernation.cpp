@@ -0,0 +1,282 @@
+#include <node.h>
+#include "Recognizer.h"
+
+using namespace v8;
+using namespace std;
+
+void Recognizer::Hibernate(const FunctionCallbackInfo<Value>& args) {
+	Isolate* isolate = args.GetIsolate();
+	HandleScope scope(isolate);
+	Local<Context> context = isolate->GetCurrentContext();
+	Recognizer* instance = node::ObjectWrap::Unwrap<Recognizer>(args.Holder());
+
+	if(args.Length() < 1 || !(args[0]->IsObject() || (args[0]->IsBoolean() && !args[0]->BooleanValue(isolate)))) {
+		Recognizer::TypeError(instance, isolate, "Expected options to be an object or false");
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	if(args[0]->IsBoolean()) {
+		instance->idleMs = 0;
+		if(instance->idleTimer != NULL) {
+			uv_timer_stop(instance->idleTimer);
+		}
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	Local<Object> options = args[0].As<Object>();
+	Local<Value> idle = Default(options->Get(context, NewString(isolate, "idle")).ToLocalChecked(), Number::New(isolate, 60000));
+	if(!idle->IsNumber() || idle->NumberValue(context).FromJust() < 1) {
+		Recognizer::TypeError(instance, isolate, "Expected idle to be a positive number of milliseconds");
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	if(instance->idleTimer == NULL) {
+		instance->idleTimer = new uv_timer_t();
+		uv_timer_init(instance->addon->loop, instance->idleTimer);
+		instance->idleTimer->data = instance;
+		// An idle Recognizer must not keep the process alive
+		uv_unref(reinterpret_cast<uv_handle_t*>(instance->idleTimer));
+	}
+	instance->idleMs = uint64_t(idle->NumberValue(context).FromJust());
+	Touch(instance);
+
+	args.GetReturnValue().Set(args.Holder());
+}
+
+void Recognizer::HibernationStats(const FunctionCallbackInfo<Value>& args) {
+	Isolate* isolate = args.GetIsolate();
+	HandleScope scope(isolate);
+	Local<Context> context = isolate->GetCurrentContext();
+	Recognizer* instance = node::ObjectWrap::Unwrap<Recognizer>(args.Holder());
+
+	Local<Object> stats = Object::New(isolate);
+	stats->Set(context, NewString(isolate, "enabled"), Boolean::New(isolate, instance->idleMs > 0)).Check();
+	stats->Set(context, NewString(isolate, "idle"), Number::New(isolate, double(instance->idleMs))).Check();
+	stats->Set(context, NewString(isolate, "hibernated"), Boolean::New(isolate, instance->hibernated)).Check();
+	stats->Set(context, NewString(isolate, "restoring"), Boolean::New(isolate, instance->restoring)).Check();
+	stats->Set(context, NewString(isolate, "hibernations"), Number::New(isolate, instance->hibernations)).Check();
+	stats->Set(context, NewString(isolate, "restores"), Number::New(isolate, instance->restores)).Check();
+	stats->Set(context, NewString(isolate, "lastRestore"), Number::New(isolate, instance->lastRestore)).Check();
+
+	args.GetReturnValue().Set(stats);
+}
+
+void Recognizer::Touch(Recognizer* instance) {
+	if(instance->idleTimer != NULL && instance->idleMs > 0) {
+		uv_timer_start(instance->idleTimer, IdleTimeout, instance->idleMs, 0);
+	}
+}
+
+void Recognizer::IdleTimeout(uv_timer_t* handle) {
+	Recognizer* instance = reinterpret_cast<Recognizer*>(handle->data);
+	if(instance->destructed || instance->hibernated)
+		return;
+
+	// Utterances, native jobs on the decoder and queued writes or controls all use it
+	if(instance->processing || instance->busy || !instance->queue.Idle()) {
+		Touch(instance);
+		return;
+	}
+
+	Sleep(instance);
+
+	Isolate* isolate = instance->addon->isolate;
+	HandleScope scope(isolate);
+	Emit(instance, isolate, "hibernated", instance->hibernatedCallback, 0, NULL);
+}
+
+void Recognizer::Sleep(Recognizer* instance) {
+	// The configuration already holds the beams, paths and the dictionary, the rest is remembered compactly
+	const char* search = ps_get_search(instance->ps);
+	instance->hibernatedSearch = search != NULL ? search : "";
+	instance->hibernatedConfig = cmd_ln_retain(ps_get_config(instance->ps));
+
+	FreeChannels(instance);
+	ps_free(instance->ps);
+	instance->ps = NULL;
+	instance->hibernated = true;
+	instance->hibernations++;
+
+	// Keyword searches went with the decoder, they are built again when selected
+	InvalidateKeywords(instance);
+
+	UpdateMemory(instance);
+}
+
+bool Recognizer::Wake(Recognizer* instance, Isolate* isolate) {
+	Touch(instance);
+	if(!instance->hibernated)
+		return true;
+
+	// Calls that need the decoder right away rebuild it on the loop thread
+	RestoreData* data = PrepareRestore(instance);
+	BuildDecoder(data, instance->addon);
+	return Restored(instance, isolate, data);
+}
+
+void Recognizer::QueueRestore(Recognizer* instance) {
+	Touch(instance);
+	if(!instance->hibernated || instance->restoring)
+		return;
+
+	// start() and the writes queue behind it, so ps_init and loading the models don't block the loop
+	RestoreData* data = PrepareRestore(instance);
+	data->job.work = RestoreWorker;
+	data->job.after = RestoreAfter;
+	instance->restoring = true;
+	instance->queue.Push(&data->job);
+}
+
+RestoreData* Recognizer::PrepareRestore(Recognizer* instance) {
+	RestoreData* data = new RestoreData();
+	data->job.data = data;
+	// ps_init writes to its configuration, record() and reconfig() read the hibernated one meanwhile
+	data->config = CopyConfig(instance->hibernatedConfig);
+	data->words = instance->addedWords;
+	data->searches = instance->searches;
+	data->search = instance->hibernatedSearch;
+	map<string, KeywordList>::iterator it = instance->keywordLists.find(data->search);
+	data->spotting = it != instance->keywordLists.end();
+	if(data->spotting) {
+		data->keywords = it->second;
+	}
+	data->ps = NULL;
+	data->error = NULL;
+	data->duration = 0;
+	return data;
+}
+
+void Recognizer::BuildDecoder(RestoreData* data, AddonData* addon) {
+	// No V8 access in here unless addon is given, the restore job calls it on a libuv pool thread
+	uint64_t start = uv_hrtime();
+	ps_decoder_t* ps = ps_init(data->config);
+	if(ps == NULL) {
+		data->error = "Failed to restore hibernated decoder";
+		return;
+	}
+
+	for(size_t i = 0; i < data->words.size(); i++) {
+		ps_add_word(ps, data->words[i].first.c_str(), data->words[i].second.c_str(), i + 1 == data->words.size());
+	}
+
+	for(size_t i = 0; i < data->searches.size() && data->error == NULL; i++) {
+		const SearchDefinition& search = data->searches[i];
+		int result;
+		// The loop thread never waits for the model cache, pool threads may
+		if(addon != NULL && search.type == SEARCH_NGRAM) {
+			result = ps_set_lm_file(ps, search.name.c_str(), CachedNgram(addon, search.argument.c_str()).c_str());
+		} else {
+			result = AddSearch(ps, search);
+		}
+		if(result < 0) {
+			data->error = "Failed to restore a search of the hibernated decoder";
+		}
+	}
+
+	// Select the search that was active before, a keyword list has to be built first
+	if(data->error == NULL && data->spotting) {
+		data->error = data->keywords.Apply(ps, data->search.c_str());
+	}
+	if(data->error == NULL && !data->search.empty() && ps_set_search(ps, data->search.c_str()) < 0) {
+		data->error = "Failed to select the search of the hibernated decoder";
+	}
+
+	// Half a decoder is worse than none, the Recognizer stays hibernated
+	if(data->error != NULL) {
+		ps_free(ps);
+		ps = NULL;
+	}
+	data->ps = ps;
+	data->duration = (uv_hrtime() - start) / 1e6;
+}
+
+void Recognizer::RestoreWorker(DecoderJob* job) {
+	RestoreData* data = reinterpret_cast<RestoreData*>(job->data);
+	TraceSpan span("decode", "restore", job->instance->traceId);
+
+	BuildDecoder(data, NULL);
+}
+
+void Recognizer::RestoreAfter(DecoderJob* job) {
+	RestoreData* data = reinterpret_cast<RestoreData*>(job->data);
+	Recognizer* instance = job->instance;
+	Isolate* isolate = instance->addon->isolate;
+	HandleScope scope(isolate);
+
+	// Handlers of the result may ask for the next restore already
+	instance->restoring = false;
+
+	// Queued before free(), the decoder has no Recognizer to go to
+	if(instance->destructed) {
+		if(data->ps != NULL)
+			ps_free(data->ps);
+		cmd_ln_free_r(data->config);
+		delete data;
+		return;
+	}
+
+	Restored(instance, isolate, data);
+}
+
+bool Recognizer::Restored(Recognizer* instance, Isolate* isolate, RestoreData* data) {
+	cmd_ln_free_r(data->config);
+
+	if(data->ps == NULL) {
+		// The next call that needs the decoder tries again
+		const char* error = data->error;
+		delete data;
+		Recognizer::Error(instance, isolate, error);
+		return false;
+	}
+
+	instance->ps = data->ps;
+	instance->hibernated = false;
+	cmd_ln_free_r(instance->hibernatedConfig);
+	instance->hibernatedConfig = NULL;
+	// The selected search has the configured beams, not those of the pruning level
+	instance->pruning.SearchChanged();
+
+	instance->restores++;
+	instance->lastRestore = data->duration;
+	delete data;
+	UpdateMemory(instance);
+
+	EventArg argv[1];
+	argv[0].SetNumber(instance->lastRestore);
+	Emit(instance, isolate, "restored", instance->restoredCallback, 1, argv);
+	return true;
+}
+
+cmd_ln_t* Recognizer::CopyConfig(cmd_ln_t* config) {
+	cmd_ln_t* copy = cmd_ln_init(NULL, ps_args(), TRUE, NULL);
+	for(const arg_t* arg = ps_args(); arg->name != NULL; arg++) {
+		if(!cmd_ln_exists_r(config, arg->name))
+			continue;
+
+		if(arg->type & ARG_INTEGER) {
+			cmd_ln_set_int_r(copy, arg->name, cmd_ln_int_r(config, arg->name));
+		} else if(arg->type & ARG_FLOATING) {
+			cmd_ln_set_float_r(copy, arg->name, cmd_ln_float_r(config, arg->name));
+		} else if(arg->type & ARG_BOOLEAN) {
+			cmd_ln_set_boolean_r(copy, arg->name, cmd_ln_boolean_r(config, arg->name));
+		} else if(arg->type & ARG_STRING) {
+			cmd_ln_set_str_r(copy, arg->name, cmd_ln_str_r(config, arg->name));
+		}
+	}
+	return copy;
+}
+
+cmd_ln_t* Recognizer::DecoderConfig(Recognizer* instance) {
+	return instance->hibernated ? instance->hibernatedConfig : ps_get_config(instance->ps);
+}
+
+const char* Recognizer::ActiveSearch(Recognizer* instance) {
+	if(instance->hibernated)
+		return instance->hibernatedSearch.c_str();
+
+	const char* search = ps_get_search(instance->ps);
+	return search != NULL ? search : "";
+}
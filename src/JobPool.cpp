@@ -0,0 +1,72 @@
+#include "JobPool.h"
+
+JobPool::JobPool(size_t capacity, size_t limit) : capacity(capacity), limit(limit), active(0) {
+
+}
+
+JobPool::~JobPool() {
+	for(size_t i = 0; i < pool.size(); i++)
+		delete pool[i];
+	pool.clear();
+}
+
+AsyncData* JobPool::Acquire(bool limited) {
+	if(limited && active >= limit)
+		return NULL;
+
+	AsyncData* job;
+	if(pool.empty()) {
+		job = new AsyncData();
+	} else {
+		job = pool.back();
+		pool.pop_back();
+	}
+
+	job->job.data = job;
+	job->job.instance = NULL;
+	job->job.work = NULL;
+	job->job.after = NULL;
+	job->type = JOB_WRITE;
+	job->decoded = true;
+	job->hasException = false;
+	job->exception = NULL;
+	job->data = NULL;
+	job->length = 0;
+	job->duration = 0;
+	job->ahead = 0;
+	job->score = 0;
+	job->hyp.clear();
+	job->frames = 0;
+	job->inSpeech = false;
+	job->spotting = false;
+	job->keywords.clear();
+	job->decodeTime = 0;
+	job->chunk = 0;
+	job->enqueued = 0;
+	job->queueDelay = 0;
+
+	active++;
+	return job;
+}
+
+void JobPool::Release(AsyncData* job) {
+	// Unpin the buffer so it can be collected
+	job->buffer.Reset();
+	job->job.instance = NULL;
+	job->data = NULL;
+	active--;
+
+	if(pool.size() < capacity) {
+		pool.push_back(job);
+	} else {
+		delete job;
+	}
+}
+
+void JobPool::SetCapacity(size_t capacity) {
+	this->capacity = capacity;
+	while(pool.size() > capacity) {
+		delete pool.back();
+		pool.pop_back();
+	}
+}
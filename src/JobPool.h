@@ -0,0 +1,85 @@
+#ifndef JOBPOOL_H
+#define JOBPOOL_H
+
+#include <uv.h>
+#include <v8.h>
+#include <pocketsphinx.h>
+
+#include "DecoderQueue.h"
+#include "KeywordList.h"
+
+#include <string>
+#include <vector>
+
+class Recognizer;
+
+enum AsyncJobType {
+	JOB_WRITE,
+	// start(), stop() and restart() wait behind the chunks written before them
+	JOB_START,
+	JOB_STOP,
+	JOB_RESTART,
+	// free() while a chunk is decoded releases the decoder after it
+	JOB_FREE
+};
+
+typedef struct AsyncData {
+	DecoderJob job;
+	int type;
+	// Keeps the written buffer alive until AsyncAfter ran
+	v8::Persistent<v8::Object> buffer;
+	// False when the chunk arrived outside of an utterance and was skipped
+	bool decoded;
+	bool hasException;
+	const char* exception;
+	int16* data;
+	size_t length;
+	// Seconds of audio in the chunk, taken while the decoder was known
+	double duration;
+	// Milliseconds of audio of the same Recognizer that waited to be decoded when the chunk was written
+	double ahead;
+	int32 score;
+	std::string hyp;
+	// Frames decoded in the utterance and the voice activity state after the chunk
+	int32 frames;
+	bool inSpeech;
+	// Set on the loop thread when a keyword list is the active search, its new detections replace hyp
+	bool spotting;
+	std::vector<KeywordDetection> keywords;
+	// Seconds spent in ps_process_raw
+	double decodeTime;
+	// Number of the chunk within its Recognizer, ties the trace spans of one chunk together
+	uint32_t chunk;
+	// When the job was queued and how many milliseconds it waited for a pool thread
+	uint64_t enqueued;
+	double queueDelay;
+} AsyncData;
+
+// Bounded free list of AsyncData objects so that write() does not allocate per call,
+// also caps the jobs in flight since every queued chunk pins its buffer
+class JobPool
+{
+public:
+	explicit JobPool(size_t capacity = 64, size_t limit = 4096);
+	~JobPool();
+
+	// NULL once limit jobs are in flight, unless the job is not limited
+	AsyncData* Acquire(bool limited = true);
+	void Release(AsyncData* job);
+
+	void SetCapacity(size_t capacity);
+	void SetLimit(size_t limit) { this->limit = limit; }
+
+	size_t Capacity() const { return capacity; }
+	size_t Limit() const { return limit; }
+	size_t Pooled() const { return pool.size(); }
+	size_t Active() const { return active; }
+
+private:
+	std::vector<AsyncData*> pool;
+	size_t capacity;
+	size_t limit;
+	size_t active;
+};
+
+#endif
@@ -0,0 +1,92 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "KeywordList.h"
+
+using namespace std;
+
+KeywordList::KeywordList() : dirty(true) {
+
+}
+
+void KeywordList::Clear() {
+	thresholds.clear();
+	dirty = true;
+}
+
+void KeywordList::Set(const string& phrase, double threshold) {
+	map<string, double>::iterator it = thresholds.find(phrase);
+	if(it != thresholds.end() && it->second == threshold)
+		return;
+	thresholds[phrase] = threshold;
+	dirty = true;
+}
+
+bool KeywordList::Remove(const string& phrase) {
+	if(thresholds.erase(phrase) == 0)
+		return false;
+	dirty = true;
+	return true;
+}
+
+bool KeywordList::Normalize(const string& phrase, string* normalized) {
+	normalized->clear();
+	size_t i = 0;
+	while(i < phrase.size()) {
+		char c = phrase[i];
+		if(c == '/' || c == '\n' || c == '\r')
+			return false;
+		if(c == ' ' || c == '\t') {
+			i++;
+			continue;
+		}
+
+		size_t end = phrase.find_first_of(" \t/\n\r", i);
+		if(end == string::npos)
+			end = phrase.size();
+		if(!normalized->empty())
+			normalized->push_back(' ');
+		normalized->append(phrase, i, end - i);
+		i = end;
+	}
+	return !normalized->empty();
+}
+
+const char* KeywordList::Apply(ps_decoder_t* ps, const char* name) {
+	if(thresholds.empty())
+		return "Keyword list is empty";
+
+	// PocketSphinx only builds keyword searches from files and has no way to add or remove a phrase
+	// of an existing one, so every apply hands it a short lived file with the whole list
+	const char* tmpdir = getenv("TMPDIR");
+	string path = string(tmpdir ? tmpdir : "/tmp") + "/pocketsphinx-kws-XXXXXX";
+	int fd = mkstemp(&path[0]);
+	if(fd < 0)
+		return "Could not create keyword file";
+
+	FILE* file = fdopen(fd, "w");
+	if(file == NULL) {
+		close(fd);
+		unlink(path.c_str());
+		return "Could not create keyword file";
+	}
+	for(map<string, double>::iterator it = thresholds.begin(); it != thresholds.end(); ++it)
+		fprintf(file, "%s /%.17g/\n", it->first.c_str(), it->second);
+	fclose(file);
+
+	// Replacing the active search leaves the decoder pointing to the old one, select it again.
+	// The name may belong to the old search, keep a copy
+	string search = name;
+	const char* active = ps_get_search(ps);
+	bool isActive = active != NULL && search == active;
+
+	int result = ps_set_kws(ps, search.c_str(), path.c_str());
+	unlink(path.c_str());
+	if(result < 0)
+		return "Failed to add keywords search to recognizer";
+	if(isActive)
+		ps_set_search(ps, search.c_str());
+
+	dirty = false;
+	return NULL;
+}
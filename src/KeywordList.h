@@ -0,0 +1,46 @@
+#ifndef KEYWORDLIST_H
+#define KEYWORDLIST_H
+
+#include <pocketsphinx.h>
+
+#include <map>
+#include <string>
+
+// Phrase spotted in a chunk, collected next to the decoder and emitted on the loop thread
+typedef struct KeywordDetection {
+	std::string phrase;
+	int32 start;
+	int32 end;
+	int32 score;
+} KeywordDetection;
+
+// Keyword spotting search kept in memory, edits are collected and applied with one rebuild
+class KeywordList
+{
+public:
+	KeywordList();
+
+	void Clear();
+	void Set(const std::string& phrase, double threshold);
+	bool Remove(const std::string& phrase);
+
+	size_t Size() const { return thresholds.size(); }
+	bool Dirty() const { return dirty; }
+	const std::map<std::string, double>& Thresholds() const { return thresholds; }
+
+	// The search was dropped together with its decoder, the next Apply builds it again
+	void Invalidate() { dirty = true; }
+
+	// Words separated by single spaces, false for phrases a keyword file can't hold: empty ones and
+	// those with a '/', which starts the threshold, or a line break, which starts the next phrase
+	static bool Normalize(const std::string& phrase, std::string* normalized);
+
+	// Rebuilds the kws search name of the decoder from the current list
+	const char* Apply(ps_decoder_t* ps, const char* name);
+
+private:
+	std::map<std::string, double> thresholds;
+	bool dirty;
+};
+
+#endif
@@ -0,0 +1,56 @@
+#include <sys/stat.h>
+#include "MemoryTracker.h"
+
+#include <atomic>
+#include <string>
+
+using namespace std;
+
+static atomic<int64_t> decoders(0);
+static atomic<int64_t> bytes(0);
+
+// Files of an acoustic model directory that are loaded into memory
+static const char* const hmmFiles[] = { "mdef", "means", "variances", "mixture_weights", "sendump", "transition_matrices", "noisedict", NULL };
+// Arguments naming files that are loaded into memory as a whole
+static const char* const fileArgs[] = { "-dict", "-fdict", "-lm", "-fsg", "-jsgf", "-kws", NULL };
+
+static int64_t FileSize(const string& path) {
+	struct stat info;
+	if(stat(path.c_str(), &info) != 0)
+		return 0;
+	return int64_t(info.st_size);
+}
+
+int64_t MemoryTracker::Estimate(cmd_ln_t* config) {
+	int64_t total = 0;
+
+	const char* hmm = cmd_ln_str_r(config, "-hmm");
+	if(hmm != NULL) {
+		string directory(hmm);
+		for(size_t i = 0; hmmFiles[i] != NULL; i++) {
+			total += FileSize(directory + "/" + hmmFiles[i]);
+		}
+	}
+
+	for(size_t i = 0; fileArgs[i] != NULL; i++) {
+		const char* path = cmd_ln_str_r(config, fileArgs[i]);
+		if(path != NULL) {
+			total += FileSize(path);
+		}
+	}
+
+	return total;
+}
+
+void MemoryTracker::Adjust(int count, int64_t size) {
+	decoders += count;
+	bytes += size;
+}
+
+size_t MemoryTracker::Decoders() {
+	return size_t(decoders.load());
+}
+
+int64_t MemoryTracker::Bytes() {
+	return bytes.load();
+}
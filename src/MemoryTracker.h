@@ -0,0 +1,21 @@
+#ifndef MEMORYTRACKER_H
+#define MEMORYTRACKER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pocketsphinx.h>
+
+// Process wide count of live decoders and their estimated native memory, shared by all threads
+class MemoryTracker
+{
+public:
+	// Footprint of one decoder estimated from the sizes of the model files it loads,
+	// PocketSphinx has no way to ask a decoder for its allocations
+	static int64_t Estimate(cmd_ln_t* config);
+
+	static void Adjust(int decoders, int64_t bytes);
+	static size_t Decoders();
+	static int64_t Bytes();
+};
+
+#endif
@@ -0,0 +1,222 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <uv.h>
+#include "ModelCache.h"
+
+#include <map>
+#include <set>
+
+using namespace std;
+
+typedef struct CachedFile {
+	off_t size;
+	time_t mtime;
+	string target;
+} CachedFile;
+
+static uv_once_t once = UV_ONCE_INIT;
+static uv_mutex_t lock;
+static uv_cond_t converted;
+static string directory;
+static map<string, CachedFile> resolved;
+// Files queued by Lookup() and files that are hashed or converted right now
+static set<string> scheduled;
+static set<string> converting;
+static size_t hits = 0;
+static size_t conversions = 0;
+
+static void InitOnce() {
+	uv_mutex_init(&lock);
+	uv_cond_init(&converted);
+}
+
+void ModelCache::SetDirectory(const char* dir) {
+	uv_once(&once, InitOnce);
+	uv_mutex_lock(&lock);
+	directory.assign(dir ? dir : "");
+	resolved.clear();
+	uv_mutex_unlock(&lock);
+}
+
+bool ModelCache::Enabled() {
+	return !Directory().empty();
+}
+
+string ModelCache::Directory() {
+	uv_once(&once, InitOnce);
+	uv_mutex_lock(&lock);
+	string dir = directory;
+	uv_mutex_unlock(&lock);
+	return dir;
+}
+
+size_t ModelCache::Hits() {
+	uv_once(&once, InitOnce);
+	uv_mutex_lock(&lock);
+	size_t count = hits;
+	uv_mutex_unlock(&lock);
+	return count;
+}
+
+size_t ModelCache::Conversions() {
+	uv_once(&once, InitOnce);
+	uv_mutex_lock(&lock);
+	size_t count = conversions;
+	uv_mutex_unlock(&lock);
+	return count;
+}
+
+string ModelCache::Lookup(const char* path, bool* convert) {
+	uv_once(&once, InitOnce);
+	*convert = false;
+
+	if(ngram_file_name_to_type(path) == NGRAM_BIN)
+		return path;
+
+	struct stat info;
+	if(stat(path, &info) != 0)
+		return path;
+
+	uv_mutex_lock(&lock);
+	string result = path;
+	map<string, CachedFile>::iterator it = resolved.find(path);
+	if(it != resolved.end() && it->second.size == info.st_size && it->second.mtime == info.st_mtime) {
+		hits++;
+		result = it->second.target;
+	} else if(!directory.empty() && scheduled.insert(path).second) {
+		// Only the first caller queues the conversion
+		*convert = true;
+	}
+	uv_mutex_unlock(&lock);
+	return result;
+}
+
+string ModelCache::Ngram(const char* path) {
+	uv_once(&once, InitOnce);
+
+	// Binary models are loaded as they are
+	if(ngram_file_name_to_type(path) == NGRAM_BIN)
+		return path;
+
+	struct stat info;
+	if(stat(path, &info) != 0)
+		return path;
+
+	uv_mutex_lock(&lock);
+	for(;;) {
+		if(directory.empty()) {
+			uv_mutex_unlock(&lock);
+			return path;
+		}
+
+		// Known file that did not change since, no need to hash it again
+		map<string, CachedFile>::iterator it = resolved.find(path);
+		if(it != resolved.end() && it->second.size == info.st_size && it->second.mtime == info.st_mtime) {
+			hits++;
+			string target = it->second.target;
+			uv_mutex_unlock(&lock);
+			return target;
+		}
+
+		// Another thread converts the same file, use its result instead of converting twice
+		if(converting.count(path) == 0)
+			break;
+		uv_cond_wait(&converted, &lock);
+	}
+	converting.insert(path);
+	string dir = directory;
+	uv_mutex_unlock(&lock);
+
+	// Hashing and converting take long, other models are resolved meanwhile
+	string result = path;
+	bool convertedNow = false;
+	uint64_t hash;
+	if(Hash(path, &hash)) {
+		char name[32];
+		snprintf(name, sizeof(name), "/%016llx.lm.bin", (unsigned long long)hash);
+		string target = dir + name;
+
+		// Another process may have converted the file already
+		if(access(target.c_str(), R_OK) == 0) {
+			result = target;
+		} else if(Convert(path, target)) {
+			convertedNow = true;
+			result = target;
+		}
+	}
+
+	uv_mutex_lock(&lock);
+	converting.erase(path);
+	scheduled.erase(path);
+	// The directory may have been switched meanwhile, don't remember a file of the old one
+	if(result != path && dir == directory) {
+		if(convertedNow)
+			conversions++;
+		else
+			hits++;
+		CachedFile entry;
+		entry.size = info.st_size;
+		entry.mtime = info.st_mtime;
+		entry.target = result;
+		resolved[path] = entry;
+	}
+	uv_cond_broadcast(&converted);
+	uv_mutex_unlock(&lock);
+	return result;
+}
+
+bool ModelCache::Hash(const char* path, uint64_t* hash) {
+	FILE* file = fopen(path, "rb");
+	if(file == NULL)
+		return false;
+
+	// 64 bit FNV-1a over the whole content
+	uint64_t value = 14695981039346656037ULL;
+	unsigned char buffer[65536];
+	size_t read;
+	while((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+		for(size_t i = 0; i < read; i++) {
+			value ^= buffer[i];
+			value *= 1099511628211ULL;
+		}
+	}
+
+	bool failed = ferror(file) != 0;
+	fclose(file);
+
+	*hash = value;
+	return !failed;
+}
+
+bool ModelCache::Convert(const char* path, const string& target) {
+	logmath_t* lmath = logmath_init(1.0001, 0, 0);
+	ngram_model_t* lm = ngram_model_read(NULL, path, NGRAM_AUTO, lmath);
+	if(lm == NULL) {
+		logmath_free(lmath);
+		return false;
+	}
+
+	// Write next to the target and rename, so other processes never see a partial file. Files with the
+	// same content have the same target, so every conversion needs a temporary file of its own
+	string temporary = target + ".XXXXXX";
+	int fd = mkstemp(&temporary[0]);
+	if(fd < 0) {
+		ngram_model_free(lm);
+		logmath_free(lmath);
+		return false;
+	}
+	// mkstemp only lets the owner read it, other processes share the cache
+	fchmod(fd, 0644);
+	close(fd);
+
+	bool written = ngram_model_write(lm, temporary.c_str(), NGRAM_BIN) == 0 &&
+		rename(temporary.c_str(), target.c_str()) == 0;
+	if(!written)
+		unlink(temporary.c_str());
+
+	ngram_model_free(lm);
+	logmath_free(lmath);
+	return written;
+}
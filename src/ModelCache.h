@@ -0,0 +1,35 @@
+#ifndef MODELCACHE_H
+#define MODELCACHE_H
+
+#include <stdint.h>
+#include <pocketsphinx.h>
+
+#include <string>
+
+// On-disk cache of language models converted to the binary format, keyed by the hash of the source file.
+// Shared by all threads and processes using the same directory.
+class ModelCache
+{
+public:
+	static void SetDirectory(const char* directory);
+	static bool Enabled();
+	static std::string Directory();
+
+	// Returns the path of the binary version of an ARPA model, hashing and converting it on first use.
+	// Falls back to path itself when the cache is disabled or the conversion failed.
+	// Blocks for as long as the conversion takes, so it is only called on worker threads.
+	static std::string Ngram(const char* path);
+
+	// Binary version of a model that was resolved before, path itself otherwise. Only stats the file,
+	// so it is cheap enough for the JS thread. Sets convert when the caller should run Ngram() on a worker.
+	static std::string Lookup(const char* path, bool* convert);
+
+	static size_t Hits();
+	static size_t Conversions();
+
+private:
+	static bool Hash(const char* path, uint64_t* hash);
+	static bool Convert(const char* path, const std::string& target);
+};
+
+#endif
@@ -0,0 +1,98 @@
+#include <node.h>
+#include "Recognizer.h"
+
+using namespace v8;
+using namespace std;
+
+void Recognizer::ModelCacheStats(const FunctionCallbackInfo<Value>& args) {
+	Isolate* isolate = args.GetIsolate();
+	HandleScope scope(isolate);
+	Local<Context> context = isolate->GetCurrentContext();
+
+	if(args.Length() >= 1) {
+		if(args[0]->IsNull() || args[0]->IsUndefined()) {
+			ModelCache::SetDirectory(NULL);
+		} else if(args[0]->IsString()) {
+			ModelCache::SetDirectory(*String::Utf8Value(isolate, args[0]));
+		} else {
+			isolate->ThrowException(Exception::TypeError(NewString(isolate, "Expected directory to be a string or null")));
+			return;
+		}
+	}
+
+	Local<Object> stats = Object::New(isolate);
+	stats->Set(context, NewString(isolate, "enabled"), Boolean::New(isolate, ModelCache::Enabled())).Check();
+	stats->Set(context, NewString(isolate, "directory"), NewString(isolate, ModelCache::Directory().c_str())).Check();
+	stats->Set(context, NewString(isolate, "hits"), Number::New(isolate, double(ModelCache::Hits()))).Check();
+	stats->Set(context, NewString(isolate, "conversions"), Number::New(isolate, double(ModelCache::Conversions()))).Check();
+
+	args.GetReturnValue().Set(stats);
+}
+
+void Recognizer::PrepareModel(const FunctionCallbackInfo<Value>& args) {
+	Isolate* isolate = args.GetIsolate();
+	HandleScope scope(isolate);
+	AddonData* addon = AddonData::From(args.Data());
+
+	if(args.Length() < 2 || !args[0]->IsString() || !args[1]->IsFunction()) {
+		isolate->ThrowException(Exception::TypeError(NewString(isolate, "Expected path to be a string and callback to be a function")));
+		return;
+	}
+
+	ConvertModel(addon, isolate, *String::Utf8Value(isolate, args[0]), Local<Function>::Cast(args[1]));
+}
+
+string Recognizer::CachedNgram(AddonData* addon, const char* path) {
+	// Never hash or convert on the JS thread, the decoder reads the text model this time
+	// and the binary version is ready for the next one
+	bool convert;
+	string result = ModelCache::Lookup(path, &convert);
+	if(convert)
+		ConvertModel(addon, addon->isolate, path, Local<Function>());
+	return result;
+}
+
+void Recognizer::ConvertModel(AddonData* addon, Isolate* isolate, const char* path, Local<Function> callback) {
+	ModelConversionData* data = new ModelConversionData();
+	data->request.data = data;
+	data->addon = addon;
+	if(!callback.IsEmpty())
+		data->callback.Reset(isolate, callback);
+	data->path = path;
+	data->error = NULL;
+
+	// The loop has to outlive the request
+	addon->Hold();
+	uv_queue_work(addon->loop, &data->request, ConvertModelWorker, (uv_after_work_cb)ConvertModelAfter);
+}
+
+void Recognizer::ConvertModelWorker(uv_work_t* request) {
+	ModelConversionData* data = reinterpret_cast<ModelConversionData*>(request->data);
+	TraceSpan span("model", "convertModel", 0);
+
+	data->target = ModelCache::Ngram(data->path.c_str());
+	if(data->target == data->path && ModelCache::Enabled() && ngram_file_name_to_type(data->path.c_str()) != NGRAM_BIN)
+		data->error = "Failed to convert language model";
+}
+
+void Recognizer::ConvertModelAfter(uv_work_t* request) {
+	ModelConversionData* data = reinterpret_cast<ModelConversionData*>(request->data);
+	AddonData* addon = data->addon;
+
+	if(!data->callback.IsEmpty() && !addon->closing) {
+		Isolate* isolate = addon->isolate;
+		HandleScope scope(isolate);
+		Local<Function> cb = Local<Function>::New(isolate, data->callback);
+		if(data->error != NULL) {
+			Local<Value> argv[1] = { Exception::Error(NewString(isolate, data->error)) };
+			CallFunction(isolate, cb, 1, argv);
+		} else {
+			Local<Value> argv[2] = { Null(isolate), NewString(isolate, data->target.c_str()) };
+			CallFunction(isolate, cb, 2, argv);
+		}
+	}
+
+	data->callback.Reset();
+	delete data;
+	addon->Release();
+}
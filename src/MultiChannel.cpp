@@ -0,0 +1,291 @@
+#include <node.h>
+#include <algorithm>
+#include "Recognizer.h"
+
+using namespace v8;
+using namespace std;
+
+void Recognizer::DecodeChannels(const FunctionCallbackInfo<Value>& args) {
+	Isolate* isolate = args.GetIsolate();
+	HandleScope scope(isolate);
+	Local<Context> context = isolate->GetCurrentContext();
+	Recognizer* instance = node::ObjectWrap::Unwrap<Recognizer>(args.Holder());
+
+	if(!Ready(instance, isolate)) {
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	if(args.Length() < 3) {
+		Recognizer::TypeError(instance, isolate, "Incorrect number of arguments, expected buffer, channels and callback");
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	if(!node::Buffer::HasInstance(args[0]) || !args[1]->IsUint32() || args[1]->Uint32Value(context).FromJust() < 1 || args[1]->Uint32Value(context).FromJust() > 64 || !args[2]->IsFunction()) {
+		Recognizer::TypeError(instance, isolate, "Expected data to be a buffer, channels to be between 1 and 64 and callback to be a function");
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	Local<Object> buffer = args[0].As<Object>();
+	int channels = int(args[1]->Uint32Value(context).FromJust());
+	size_t length = node::Buffer::Length(buffer) / sizeof(int16);
+	if(length % channels != 0) {
+		Recognizer::Error(instance, isolate, "Buffer does not hold a whole number of interleaved frames");
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	if(instance->processing) {
+		Recognizer::Error(instance, isolate, "Stop the recognizer before decoding channels");
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	MultiChannelData* data = new MultiChannelData();
+	data->request.data = data;
+	data->instance = instance;
+	data->callback.Reset(isolate, Local<Function>::Cast(args[2]));
+	data->buffer.Reset(isolate, buffer);
+	data->data = (const int16*) node::Buffer::Data(buffer);
+	data->frames = length / channels;
+	data->channels = channels;
+	data->error = NULL;
+	data->pending = 0;
+	data->frameRate = cmd_ln_int32_r(ps_get_config(instance->ps), "-frate");
+	data->sampleRate = cmd_ln_float32_r(ps_get_config(instance->ps), "-samprate");
+	data->start = uv_hrtime();
+
+	// Keyword lists may be edited while the channels run, the decoders use the list as it is now
+	const char* search = ps_get_search(instance->ps);
+	data->search = search != NULL ? search : "";
+	map<string, KeywordList>::iterator list = instance->keywordLists.find(data->search);
+	data->keywords = list != instance->keywordLists.end();
+	if(data->keywords) {
+		data->keywordList = list->second;
+	}
+
+	// The decoders belong to the jobs until the last channel finished
+	instance->busy = true;
+	instance->Ref();
+	instance->addon->Hold();
+
+	if(instance->channelDecoders.size() >= size_t(channels) && instance->channelVersion == instance->searchVersion) {
+		QueueChannels(data);
+	} else {
+		uv_queue_work(instance->addon->loop, &data->request, ChannelsPrepareWorker, (uv_after_work_cb)ChannelsPrepareAfter);
+	}
+
+	args.GetReturnValue().Set(args.Holder());
+}
+
+void Recognizer::ChannelsPrepareWorker(uv_work_t* request) {
+	MultiChannelData* data = reinterpret_cast<MultiChannelData*>(request->data);
+	Recognizer* instance = data->instance;
+
+	data->error = EnsureDecoders(instance, data->channels);
+}
+
+void Recognizer::ChannelsPrepareAfter(uv_work_t* request) {
+	MultiChannelData* data = reinterpret_cast<MultiChannelData*>(request->data);
+	UpdateMemory(data->instance);
+	if(data->error != NULL) {
+		FinishChannels(data);
+		return;
+	}
+	QueueChannels(data);
+}
+
+void Recognizer::QueueChannels(MultiChannelData* data) {
+	Recognizer* instance = data->instance;
+
+	data->jobs.resize(data->channels);
+	data->pending = data->channels;
+	for(int i = 0; i < data->channels; i++) {
+		ChannelJob& job = data->jobs[i];
+		job.request.data = &job;
+		job.parent = data;
+		job.channel = i;
+		job.ps = instance->channelDecoders[i];
+		job.error = NULL;
+		job.score = 0;
+		uv_queue_work(instance->addon->loop, &job.request, ChannelWorker, (uv_after_work_cb)ChannelAfter);
+	}
+}
+
+void Recognizer::ChannelWorker(uv_work_t* request) {
+	ChannelJob* job = reinterpret_cast<ChannelJob*>(request->data);
+	MultiChannelData* data = job->parent;
+	TraceSpan span("decode", "decodeChannel", data->instance->traceId);
+
+	// Every channel decodes with the search of the Recognizer
+	if(data->keywords) {
+		KeywordList list = data->keywordList;
+		job->error = list.Apply(job->ps, data->search.c_str());
+		if(job->error != NULL)
+			return;
+	}
+	if(!data->search.empty() && ps_set_search(job->ps, data->search.c_str()) < 0) {
+		job->error = "Failed to select the search of the recognizer";
+		return;
+	}
+
+	if(ps_start_utt(job->ps) < 0) {
+		job->error = "Failed to start PocketSphinx processing";
+		return;
+	}
+
+	// PocketSphinx takes contiguous samples, pick the channel out of the shared buffer block by block
+	int16 buffer[4096];
+	const int16* samples = data->data + job->channel;
+	for(size_t offset = 0; offset < data->frames; offset += 4096) {
+		size_t count = data->frames - offset < 4096 ? data->frames - offset : 4096;
+		for(size_t i = 0; i < count; i++) {
+			buffer[i] = samples[(offset + i) * data->channels];
+		}
+		if(ps_process_raw(job->ps, buffer, count, FALSE, FALSE) < 0) {
+			ps_end_utt(job->ps);
+			job->error = "Failed to process audio data";
+			return;
+		}
+	}
+
+	if(ps_end_utt(job->ps) < 0) {
+		job->error = "Failed to end PocketSphinx processing";
+		return;
+	}
+
+	int32 score;
+	const char* hyp = ps_get_hyp(job->ps, &score);
+	job->hyp.assign(hyp ? hyp : "");
+	job->score = score;
+	CollectSegments(job->ps, job->segments);
+}
+
+void Recognizer::ChannelAfter(uv_work_t* request) {
+	ChannelJob* job = reinterpret_cast<ChannelJob*>(request->data);
+	MultiChannelData* data = job->parent;
+
+	if(job->error != NULL && data->error == NULL) {
+		data->error = job->error;
+	}
+
+	if(--data->pending == 0) {
+		FinishChannels(data);
+	}
+}
+
+void Recognizer::FinishChannels(MultiChannelData* data) {
+	Recognizer* instance = data->instance;
+	AddonData* addon = instance->addon;
+	Isolate* isolate = addon->isolate;
+	HandleScope scope(isolate);
+	Local<Context> context = isolate->GetCurrentContext();
+
+	instance->busy = false;
+
+	Local<Function> cb = Local<Function>::New(isolate, data->callback);
+	if(data->error != NULL) {
+		Local<Value> argv[1] = { Exception::Error(NewString(isolate, data->error)) };
+		CallFunction(isolate, cb, 1, argv);
+	} else {
+		Local<Array> channels = Array::New(isolate, data->channels);
+		// Words of all channels ordered by their start frame, all channels share the time base of the buffer
+		vector<pair<int32, pair<int, size_t> > > order;
+		for(int i = 0; i < data->channels; i++) {
+			ChannelJob& job = data->jobs[i];
+			Local<Object> channel = Object::New(isolate);
+			channel->Set(context, NewString(isolate, "channel"), Integer::New(isolate, i)).Check();
+			channel->Set(context, NewString(isolate, "hyp"), NewString(isolate, job.hyp.c_str())).Check();
+			channel->Set(context, NewString(isolate, "score"), Number::New(isolate, job.score)).Check();
+			channel->Set(context, NewString(isolate, "segments"), SegmentArray(isolate, job.segments)).Check();
+			channels->Set(context, i, channel).Check();
+			for(size_t j = 0; j < job.segments.size(); j++) {
+				order.push_back(make_pair(job.segments[j].start, make_pair(i, j)));
+			}
+		}
+		stable_sort(order.begin(), order.end());
+
+		Local<Array> timeline = Array::New(isolate, int(order.size()));
+		for(size_t i = 0; i < order.size(); i++) {
+			const Segment& segment = data->jobs[order[i].second.first].segments[order[i].second.second];
+			Local<Object> word = Object::New(isolate);
+			word->Set(context, NewString(isolate, "channel"), Integer::New(isolate, order[i].second.first)).Check();
+			word->Set(context, NewString(isolate, "word"), NewString(isolate, segment.word.c_str())).Check();
+			word->Set(context, NewString(isolate, "start"), Integer::New(isolate, segment.start)).Check();
+			word->Set(context, NewString(isolate, "end"), Integer::New(isolate, segment.end)).Check();
+			word->Set(context, NewString(isolate, "prob"), Number::New(isolate, segment.prob)).Check();
+			timeline->Set(context, i, word).Check();
+		}
+
+		Local<Object> result = Object::New(isolate);
+		result->Set(context, NewString(isolate, "channels"), channels).Check();
+		result->Set(context, NewString(isolate, "timeline"), timeline).Check();
+		result->Set(context, NewString(isolate, "frameRate"), Integer::New(isolate, data->frameRate)).Check();
+		result->Set(context, NewString(isolate, "audioDuration"), Number::New(isolate, data->frames * 1000.0 / data->sampleRate)).Check();
+		result->Set(context, NewString(isolate, "decodeDuration"), Number::New(isolate, (uv_hrtime() - data->start) / 1e6)).Check();
+
+		Local<Value> argv[2] = { Null(isolate), result };
+		CallFunction(isolate, cb, 2, argv);
+	}
+
+	data->callback.Reset();
+	data->buffer.Reset();
+	delete data;
+	instance->Unref();
+	addon->Release();
+}
+
+const char* Recognizer::EnsureDecoders(Recognizer* instance, size_t count) {
+	// Loading models takes long, so this runs on a worker instead of the event loop.
+	// The configuration is shared with the first decoder, which is idle while busy is set,
+	// and the runtime state can't change until then either.
+	if(instance->channelVersion != instance->searchVersion) {
+		for(size_t i = 0; i < instance->channelDecoders.size(); i++) {
+			for(size_t j = 0; j < instance->searches.size(); j++) {
+				if(AddSearch(instance->channelDecoders[i], instance->searches[j]) < 0)
+					return "Failed to add a search of the recognizer";
+			}
+		}
+		instance->channelVersion = instance->searchVersion;
+	}
+
+	// Every decoder gets the words and searches added at runtime, in the order a restored decoder adds them
+	while(instance->channelDecoders.size() < count) {
+		ps_decoder_t* ps = ps_init(ps_get_config(instance->ps));
+		if(ps == NULL)
+			return "Failed to create decoder";
+		instance->channelDecoders.push_back(ps);
+		for(size_t i = 0; i < instance->addedWords.size(); i++) {
+			ps_add_word(ps, instance->addedWords[i].first.c_str(), instance->addedWords[i].second.c_str(), i + 1 == instance->addedWords.size());
+		}
+		for(size_t i = 0; i < instance->searches.size(); i++) {
+			if(AddSearch(ps, instance->searches[i]) < 0)
+				return "Failed to add a search of the recognizer";
+		}
+	}
+	return NULL;
+}
+
+int Recognizer::AddSearch(ps_decoder_t* ps, const SearchDefinition& search) {
+	const char* name = search.name.c_str();
+	if(search.type == SEARCH_KEYPHRASE)
+		return ps_set_keyphrase(ps, name, search.argument.c_str());
+	if(search.type == SEARCH_KEYWORDS)
+		return ps_set_kws(ps, name, search.argument.c_str());
+	if(search.type == SEARCH_GRAMMAR)
+		return ps_set_jsgf_file(ps, name, search.argument.c_str());
+	if(search.type == SEARCH_NGRAM) {
+		// Only called on pool threads, which may wait for the model cache
+		return ps_set_lm_file(ps, name, ModelCache::Ngram(search.argument.c_str()).c_str());
+	}
+	return -1;
+}
+
+void Recognizer::FreeChannels(Recognizer* instance) {
+	for(size_t i = 0; i < instance->channelDecoders.size(); i++) {
+		ps_free(instance->channelDecoders[i]);
+	}
+	instance->channelDecoders.clear();
+}
@@ -0,0 +1,126 @@
+#include <math.h>
+#include "PruningController.h"
+
+#include <string>
+
+using namespace std;
+
+// Every level makes the beams this many decades narrower and halves the HMMs per frame
+#define DECADES_PER_LEVEL 5
+#define MIN_HMM_PER_FRAME 500
+
+PruningController::PruningController() : enabled(false), target(1), maxLevel(0), rtf(0), level(0), applied(0), stale(false), adjustments(0) {
+
+}
+
+void PruningController::Enable(ps_decoder_t* ps, double target, int maxLevel) {
+	cmd_ln_t* config = ps_get_config(ps);
+
+	// Start over from the configured beams, e.g. after reconfig
+	baseBeam = cmd_ln_float_r(config, "-beam");
+	baseWbeam = cmd_ln_float_r(config, "-wbeam");
+	basePbeam = cmd_ln_float_r(config, "-pbeam");
+	baseMaxhmmpf = cmd_ln_int_r(config, "-maxhmmpf");
+
+	enabled = true;
+	this->target = target;
+	this->maxLevel = maxLevel;
+	rtf = 0;
+	level = 0;
+	applied = 0;
+	stale = false;
+	Compute(0);
+}
+
+void PruningController::Disable() {
+	// Level 0 brings the configured beams back with the next Apply
+	enabled = false;
+	level = 0;
+}
+
+void PruningController::Measure(double decodeTime, double audioDuration) {
+	if(!enabled || audioDuration <= 0)
+		return;
+
+	// Smooth over chunks so a single slow chunk does not flip the level
+	double current = decodeTime / audioDuration;
+	rtf = rtf == 0 ? current : rtf * 0.8 + current * 0.2;
+
+	if(rtf > target * 1.1 && level < maxLevel) {
+		level++;
+		rtf = target;
+	} else if(rtf < target * 0.7 && level > 0) {
+		level--;
+		rtf = target;
+	}
+}
+
+bool PruningController::Apply(ps_decoder_t* ps) {
+	Compute(level);
+	if(applied != level)
+		adjustments++;
+	applied = level;
+	stale = false;
+
+	return Rebuild(ps, beam, wbeam, pbeam, maxhmmpf);
+}
+
+bool PruningController::Rebuild(ps_decoder_t* ps, double beam, double wbeam, double pbeam, long maxhmmpf) {
+	const char* active = ps_get_search(ps);
+	if(active == NULL)
+		return false;
+	string name = active;
+
+	ngram_model_t* lm = ps_get_lm(ps, name.c_str());
+	fsg_model_t* fsg = lm == NULL ? ps_get_fsg(ps, name.c_str()) : NULL;
+	if(lm == NULL && fsg == NULL) {
+		// Keyword and phone loop searches keep the configured beams
+		return false;
+	}
+
+	// Searches copy the beams from the decoder configuration when they are built. Channel decoders,
+	// hibernation and the recorder hold that same configuration, so it only carries the beams of
+	// the level while the search is rebuilt and gets the configured ones back right after
+	cmd_ln_t* config = ps_get_config(ps);
+	double configuredBeam = cmd_ln_float_r(config, "-beam");
+	double configuredWbeam = cmd_ln_float_r(config, "-wbeam");
+	double configuredPbeam = cmd_ln_float_r(config, "-pbeam");
+	long configuredMaxhmmpf = cmd_ln_int_r(config, "-maxhmmpf");
+	cmd_ln_set_float_r(config, "-beam", beam);
+	cmd_ln_set_float_r(config, "-wbeam", wbeam);
+	cmd_ln_set_float_r(config, "-pbeam", pbeam);
+	cmd_ln_set_int_r(config, "-maxhmmpf", maxhmmpf);
+
+	// Build the active search again from its model instead of reloading the whole decoder with ps_reinit
+	int result;
+	if(lm != NULL) {
+		ngram_model_retain(lm);
+		result = ps_set_lm(ps, name.c_str(), lm);
+		ngram_model_free(lm);
+	} else {
+		fsg_model_retain(fsg);
+		result = ps_set_fsg(ps, name.c_str(), fsg);
+		fsg_model_free(fsg);
+	}
+
+	cmd_ln_set_float_r(config, "-beam", configuredBeam);
+	cmd_ln_set_float_r(config, "-wbeam", configuredWbeam);
+	cmd_ln_set_float_r(config, "-pbeam", configuredPbeam);
+	cmd_ln_set_int_r(config, "-maxhmmpf", configuredMaxhmmpf);
+
+	// The decoder still points to the replaced search
+	return result >= 0 && ps_set_search(ps, name.c_str()) >= 0;
+}
+
+void PruningController::Compute(int level) {
+	double factor = pow(10.0, DECADES_PER_LEVEL * level);
+	beam = baseBeam * factor < 1 ? baseBeam * factor : 1;
+	wbeam = baseWbeam * factor < 1 ? baseWbeam * factor : 1;
+	pbeam = basePbeam * factor < 1 ? basePbeam * factor : 1;
+	maxhmmpf = baseMaxhmmpf;
+	for(int i = 0; i < level && maxhmmpf > MIN_HMM_PER_FRAME; i++)
+		maxhmmpf /= 2;
+	// -1 means unlimited, give it a limit once pruning gets tighter
+	if(baseMaxhmmpf <= 0 && level > 0)
+		maxhmmpf = 30000 >> level;
+}
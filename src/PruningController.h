@@ -0,0 +1,66 @@
+#ifndef PRUNINGCONTROLLER_H
+#define PRUNINGCONTROLLER_H
+
+#include <pocketsphinx.h>
+
+// Tightens or relaxes the search beams of a decoder to keep its real time factor near a target
+class PruningController
+{
+public:
+	PruningController();
+
+	// Remembers the configured beams of the decoder as level 0
+	void Enable(ps_decoder_t* ps, double target, int maxLevel);
+	void Disable();
+	bool Enabled() const { return enabled; }
+
+	// Feeds the time spent decoding audio of the given duration, both in seconds
+	void Measure(double decodeTime, double audioDuration);
+
+	// True when the measured speed asks for other beams than the active ones
+	bool Pending() const { return level != applied || (stale && level != 0); }
+
+	// Rebuilds the active search with the beams of the current level, only valid between utterances.
+	// The decoder configuration keeps the configured beams, other decoders share it
+	bool Apply(ps_decoder_t* ps);
+
+	// Builds the active n-gram or grammar search of the decoder again with the given beams, false for
+	// other searches. Replays use it to apply the beams a recorded session switched to
+	static bool Rebuild(ps_decoder_t* ps, double beam, double wbeam, double pbeam, long maxhmmpf);
+
+	// The active search was built from the configuration again, like after a search switch or a restore
+	void SearchChanged() { stale = true; }
+
+	double Target() const { return target; }
+	double RealTimeFactor() const { return rtf; }
+	int Level() const { return stale ? 0 : applied; }
+	int MaxLevel() const { return maxLevel; }
+	unsigned int Adjustments() const { return adjustments; }
+
+	double Beam() const { return beam; }
+	double WordBeam() const { return wbeam; }
+	double PhoneBeam() const { return pbeam; }
+	long MaxHmmPerFrame() const { return maxhmmpf; }
+
+private:
+	void Compute(int level);
+
+	bool enabled;
+	double target;
+	int maxLevel;
+
+	// Smoothed real time factor and the level it asks for
+	double rtf;
+	int level;
+	int applied;
+	bool stale;
+	unsigned int adjustments;
+
+	// Beams at level 0 and at the applied level
+	double baseBeam, baseWbeam, basePbeam;
+	long baseMaxhmmpf;
+	double beam, wbeam, pbeam;
+	long maxhmmpf;
+};
+
+#endif
@@ -1,4 +1,5 @@
 #include <node.h>
+#include <float.h>
 #include <iostream>
 #include <node_buffer.h>
 #include "Recognizer.h"
@@ -11,28 +12,51 @@ Recognizer::Recognizer() {
 }
 
 Recognizer::~Recognizer() {
+	Governor::Unregister(&qos);
+	// Without the addon state the environment is gone, Teardown closed the timer already
+	if(addon != NULL) {
+		addon->recognizers.erase(this);
+		if(idleTimer != NULL) {
+			uv_close(reinterpret_cast<uv_handle_t*>(idleTimer), CloseTimer);
+		}
+	}
+	idleTimer = NULL;
 	if(destructed == false) {
 		processing = false;
-		ps_free(ps);
+		FreeChannels(this);
+		if(ps != NULL)
+			ps_free(ps);
+	}
+	if(hibernatedConfig != NULL) {
+		cmd_ln_free_r(hibernatedConfig);
+		hibernatedConfig = NULL;
 	}
 	destructed = true;
+	// Runs when the wrapper is collected, which needs every Ref() to be undone first
+	UpdateMemory(this);
 }
 
-Persistent<Function> Recognizer::constructor;
+void Recognizer::Init(Local<Object> exports, Local<Context> context) {
+	Isolate* isolate = context->GetIsolate();
+	AddonData* addon = AddonData::Create(isolate);
 
-void Recognizer::Init(Handle<Object> exports) {
-	Isolate* isolate = Isolate::GetCurrent();
-
-	Local<FunctionTemplate> tpl = FunctionTemplate::New(isolate, New);
-	tpl->SetClassName(String::NewFromUtf8(isolate,"Recognizer"));
+	Local<FunctionTemplate> tpl = FunctionTemplate::New(isolate, New, addon->External());
+	tpl->SetClassName(NewString(isolate,"Recognizer"));
 	tpl->InstanceTemplate()->SetInternalFieldCount(1);
 
-	tpl->Set(String::NewFromUtf8(isolate, "modelDirectory"), String::NewFromUtf8(isolate, MODELDIR));
-	tpl->PrototypeTemplate()->SetAccessor(String::NewFromUtf8(isolate, "search"), GetSearch, SetSearch);
+	tpl->Set(NewString(isolate, "modelDirectory"), NewString(isolate, MODELDIR));
+	tpl->PrototypeTemplate()->SetAccessor(NewString(isolate, "search"), GetSearch, SetSearch);
 
 	NODE_SET_PROTOTYPE_METHOD(tpl, "free", Free);
 	NODE_SET_PROTOTYPE_METHOD(tpl, "reconfig", Reconfig);
 	NODE_SET_PROTOTYPE_METHOD(tpl, "silenceDetection", SilenceDetection);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "endpointer", Endpointer);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "pipeline", Pipeline);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "adaptivePruning", AdaptivePruning);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "pruningStats", PruningStats);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "hibernate", Hibernate);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "hibernationStats", HibernationStats);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "qos", Qos);
 
 	NODE_SET_PROTOTYPE_METHOD(tpl, "on", On);
 	NODE_SET_PROTOTYPE_METHOD(tpl, "off", Off);
@@ -44,9 +68,18 @@ void Recognizer::Init(Handle<Object> exports) {
 	NODE_SET_PROTOTYPE_METHOD(tpl, "addKeywordsSearch", AddKeywordsSearch);
 	NODE_SET_PROTOTYPE_METHOD(tpl, "addGrammarSearch", AddGrammarSearch);
 	NODE_SET_PROTOTYPE_METHOD(tpl, "addNgramSearch", AddNgramSearch);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "setKeywords", SetKeywords);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "addKeyword", AddKeyword);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "removeKeyword", RemoveKeyword);
 
 	NODE_SET_PROTOTYPE_METHOD(tpl, "write", Write);
 	NODE_SET_PROTOTYPE_METHOD(tpl, "writeSync", WriteSync);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "decodeFile", DecodeFile);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "record", Record);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "replay", Replay);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "decodeChannels", DecodeChannels);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "confidence", Confidence);
+	NODE_SET_PROTOTYPE_METHOD(tpl, "align", Align);
 
 	NODE_SET_PROTOTYPE_METHOD(tpl, "lookupWords", LookupWords);
 	NODE_SET_PROTOTYPE_METHOD(tpl, "addWords", AddWords);
@@ -54,46 +87,72 @@ void Recognizer::Init(Handle<Object> exports) {
 	// @deprecated fromFloat should be called directly like PocketSphinx.fromFloat(buffer)
 	NODE_SET_PROTOTYPE_METHOD(tpl, "fromFloat", FromFloat);
 	
-	constructor.Reset(isolate, tpl->GetFunction());
-	exports->Set(String::NewFromUtf8(isolate, "Recognizer"), tpl->GetFunction());
+	Local<Function> cons = tpl->GetFunction(context).ToLocalChecked();
+	addon->recognizerConstructor.Reset(isolate, cons);
+	exports->Set(context, NewString(isolate, "Recognizer"), cons).Check();
 
 	NODE_SET_METHOD(exports, "fromFloat", FromFloat);
+	NODE_SET_METHOD(exports, "modelCache", ModelCacheStats);
+	NODE_SET_METHOD(exports, "governor", GovernorStats);
+	NODE_SET_METHOD(exports, "trace", Trace);
+	NODE_SET_METHOD(exports, "memory", MemoryStats);
+
+	// Module level functions that need the per isolate state get it as function data
+	Local<FunctionTemplate> jobPoolTpl = FunctionTemplate::New(isolate, JobPoolStats, addon->External());
+	exports->Set(context, NewString(isolate, "jobPool"), jobPoolTpl->GetFunction(context).ToLocalChecked()).Check();
+	Local<FunctionTemplate> eventSinkTpl = FunctionTemplate::New(isolate, SetEventSink, addon->External());
+	exports->Set(context, NewString(isolate, "eventSink"), eventSinkTpl->GetFunction(context).ToLocalChecked()).Check();
+	Local<FunctionTemplate> prepareModelTpl = FunctionTemplate::New(isolate, PrepareModel, addon->External());
+	exports->Set(context, NewString(isolate, "prepareModel"), prepareModelTpl->GetFunction(context).ToLocalChecked()).Check();
 }
 
 void Recognizer::New(const FunctionCallbackInfo<Value>& args) {
-	Isolate* isolate = Isolate::GetCurrent();
+	Isolate* isolate = args.GetIsolate();
 	HandleScope scope(isolate);
+	AddonData* addon = AddonData::From(args.Data());
 
 	if(!args.IsConstructCall()) {
 		const int argc = 2;
 		Local<Value> argv[argc] = { args[0], args[1] };
-		Local<Function> cons = Local<Function>::New(isolate, constructor);
-		args.GetReturnValue().Set(cons->NewInstance(argc, argv));
+		Local<Function> cons = Local<Function>::New(isolate, addon->recognizerConstructor);
+		MaybeLocal<Object> result = cons->NewInstance(isolate->GetCurrentContext(), argc, argv);
+		if(!result.IsEmpty())
+			args.GetReturnValue().Set(result.ToLocalChecked());
+		return;
 	}
 
 	if(args.Length() < 1) {
-		isolate->ThrowException(Exception::TypeError(String::NewFromUtf8(isolate,"Incorrect number of arguments, expected options at least")));
+		isolate->ThrowException(Exception::TypeError(NewString(isolate,"Incorrect number of arguments, expected options at least")));
 		args.GetReturnValue().Set(Undefined(isolate));
+		return;
 	}
 
 	if(!args[0]->IsObject()) {
-		isolate->ThrowException(Exception::TypeError(String::NewFromUtf8(isolate,"Expected options to be an object")));
+		isolate->ThrowException(Exception::TypeError(NewString(isolate,"Expected options to be an object")));
 		args.GetReturnValue().Set(Undefined(isolate));
+		return;
 	}
 
 	Recognizer* instance = new Recognizer();
+	instance->addon = addon;
+	addon->recognizers.insert(instance);
+	instance->queue.Init(instance, addon->loop);
+	Governor::Register(&instance->qos);
+	instance->traceId = Tracer::NextId();
+	instance->traceChunks = 0;
+	instance->traceChunk = 0;
 
 	// Add the configuration to the decoder instance
-	Handle<Object> options = args[0]->ToObject();
-	cmd_ln_t* config = BuildConfig(options);
+	Local<Object> options = args[0].As<Object>();
+	cmd_ln_t* config = BuildConfig(addon, isolate, options);
 	instance->ps = ps_init(config);
 
 
 	// Initialize the callback functions
-	Handle<Function> emptyFoo = Handle<Function>();
+	Local<Function> emptyFoo = Local<Function>();
 	if (args.Length() >= 2) {
 		if(!args[1]->IsFunction()) {
-			isolate->ThrowException(Exception::TypeError(String::NewFromUtf8(isolate, "Expected hypothesis to be a function")));
+			isolate->ThrowException(Exception::TypeError(NewString(isolate, "Expected hypothesis to be a function")));
 			args.GetReturnValue().Set(Undefined(isolate));
 		} else {
 			// Set hypothesis from arguments
@@ -111,13 +170,43 @@ void Recognizer::New(const FunctionCallbackInfo<Value>& args) {
 	instance->speechDetectedCallback.Reset(isolate, emptyFoo);
 	instance->silenceDetectedCallback.Reset(isolate, emptyFoo);
 	instance->errorCallback.Reset(isolate, emptyFoo);
+	instance->endpointCallback.Reset(isolate, emptyFoo);
+	instance->hypRescoredCallback.Reset(isolate, emptyFoo);
+	instance->keywordCallback.Reset(isolate, emptyFoo);
+	instance->droppedCallback.Reset(isolate, emptyFoo);
+	instance->lateCallback.Reset(isolate, emptyFoo);
+
+	instance->hibernatedCallback.Reset(isolate, emptyFoo);
+	instance->restoredCallback.Reset(isolate, emptyFoo);
 
 	// Set destructed to false initially
 	instance->destructed = false;
 	// Set processing to false initially
 	instance->processing = false;
+	instance->busy = false;
+	instance->replaying = NULL;
 	// Set silenceDetection to true initially
 	instance->silenceDetection = true;
+	// Single pass until a pipeline is configured
+	instance->rescoreLm = NULL;
+
+	// Report the models to V8, otherwise the tiny wrapper gives the GC no reason to collect it
+	instance->externalMemory = 0;
+	instance->trackedDecoders = 0;
+	UpdateMemory(instance);
+
+	instance->searchVersion = 0;
+	instance->channelVersion = 0;
+
+	// Hibernation is off until configured
+	instance->idleTimer = NULL;
+	instance->idleMs = 0;
+	instance->hibernated = false;
+	instance->restoring = false;
+	instance->hibernatedConfig = NULL;
+	instance->hibernations = 0;
+	instance->restores = 0;
+	instance->lastRestore = 0;
 
 	instance->Wrap(args.Holder());
 
@@ -125,40 +214,73 @@ void Recognizer::New(const FunctionCallbackInfo<Value>& args) {
 }
 
 void Recognizer::Free(const FunctionCallbackInfo<Value>& args) {
-	Isolate* isolate = Isolate::GetCurrent();
+	Isolate* isolate = args.GetIsolate();
 	HandleScope scope(isolate);
 	Recognizer* instance = node::ObjectWrap::Unwrap<Recognizer>(args.Holder());
 
-	if(instance->destructed == false) {
-		instance->processing = false;
-		ps_free(instance->ps);
+	// Native jobs like decodeFile own the decoder until their callback ran
+	if(instance->busy) {
+		Recognizer::Error(instance, isolate, "Recognizer is busy");
+		return;
 	}
+
+	if(instance->destructed)
+		return;
+
+	// Queued chunks are skipped from now on, but the one being decoded has to finish first
+	instance->processing = false;
 	instance->destructed = true;
+	if(instance->queue.Idle()) {
+		FreeDecoder(instance);
+	} else {
+		QueueControl(instance, isolate, JOB_FREE);
+	}
+}
+
+void Recognizer::FreeDecoder(Recognizer* instance) {
+	// A freed stream takes no part in admission, the destructor may run much later
+	Governor::Unregister(&instance->qos);
+	instance->recorder.Close();
+	FreeChannels(instance);
+	if(instance->ps != NULL)
+		ps_free(instance->ps);
+	instance->ps = NULL;
+	if(instance->hibernatedConfig != NULL) {
+		cmd_ln_free_r(instance->hibernatedConfig);
+		instance->hibernatedConfig = NULL;
+	}
+	instance->hibernated = false;
+	UpdateMemory(instance);
 }
 
 void Recognizer::Reconfig(const FunctionCallbackInfo<Value>& args) {
-	Isolate* isolate = Isolate::GetCurrent();
+	Isolate* isolate = args.GetIsolate();
 	HandleScope scope(isolate);
 	Recognizer* instance = node::ObjectWrap::Unwrap<Recognizer>(args.Holder());
 
+	if(!Ready(instance, isolate)) {
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
 	if(args.Length() < 1) {
-		//isolate->ThrowException(Exception::TypeError(String::NewFromUtf8(isolate, "Incorrect number of arguments, expected options at least")));
-		Recognizer::TypeError(instance, isolate, String::NewFromUtf8(isolate, "Incorrect number of arguments, expected options at least"));
+		//isolate->ThrowException(Exception::TypeError(NewString(isolate, "Incorrect number of arguments, expected options at least")));
+		Recognizer::TypeError(instance, isolate, "Incorrect number of arguments, expected options at least");
 		args.GetReturnValue().Set(Undefined(isolate));
 		return;
 	}
 
 	if(!args[0]->IsObject()) {
-		//isolate->ThrowException(Exception::TypeError(String::NewFromUtf8(isolate, "Expected options to be an object")));
-		Recognizer::TypeError(instance, isolate, String::NewFromUtf8(isolate, "Expected options to be an object"));
+		//isolate->ThrowException(Exception::TypeError(NewString(isolate, "Expected options to be an object")));
+		Recognizer::TypeError(instance, isolate, "Expected options to be an object");
 		args.GetReturnValue().Set(Undefined(isolate));
 		return;
 	}
 
 	if(args.Length() >=2) {
 		if(!args[1]->IsFunction()) {
-			//isolate->ThrowException(Exception::TypeError(String::NewFromUtf8(isolate, "Expected hypothesis to be a function")));
-			Recognizer::TypeError(instance, isolate, String::NewFromUtf8(isolate, "Expected hypothesis to be a function"));
+			//isolate->ThrowException(Exception::TypeError(NewString(isolate, "Expected hypothesis to be a function")));
+			Recognizer::TypeError(instance, isolate, "Expected hypothesis to be a function");
 			args.GetReturnValue().Set(Undefined(isolate));
 			return;
 		} else {
@@ -173,13 +295,30 @@ void Recognizer::Reconfig(const FunctionCallbackInfo<Value>& args) {
 	instance->processing = false;
 
 	// Add the configuration to the decoder instance
-	Handle<Object> options = args[0]->ToObject();
-	cmd_ln_t* config = BuildConfig(options);
-	if(ps_reinit(instance->ps, config)<0) {
-		//isolate->ThrowException(Exception::TypeError(String::NewFromUtf8(isolate, "Could not reinit decoder")));
-		Recognizer::Error(instance, isolate, String::NewFromUtf8(isolate, "Could not reinit decoder"));
+	Local<Object> options = args[0].As<Object>();
+	cmd_ln_t* config = BuildConfig(instance->addon, isolate, options);
+	int reinit = ps_reinit(instance->ps, config);
+	// Reinitializing drops the searches and words added at runtime, also when it failed halfway,
+	// so the keyword lists are built again when selected
+	ForgetDecoderState(instance);
+	if(reinit < 0) {
+		//isolate->ThrowException(Exception::TypeError(NewString(isolate, "Could not reinit decoder")));
+		Recognizer::Error(instance, isolate, "Could not reinit decoder");
 		args.GetReturnValue().Set(Undefined(isolate));
 	} else {
+		if(instance->recorder.IsOpen()) {
+			instance->recorder.Config(config);
+		}
+
+		// Decoders of other channels still use the old configuration
+		FreeChannels(instance);
+		UpdateMemory(instance);
+
+		// Beams of the new configuration are the base for the controller now
+		if(instance->pruning.Enabled()) {
+			instance->pruning.Enable(instance->ps, instance->pruning.Target(), instance->pruning.MaxLevel());
+		}
+
 		// Restart decoding when the decoder was running before
 		if(wasProcessing) {
 			Start(args);
@@ -194,54 +333,240 @@ void Recognizer::Reconfig(const FunctionCallbackInfo<Value>& args) {
 }
 
 void Recognizer::SilenceDetection(const FunctionCallbackInfo<Value>& args) {
-	Isolate* isolate = Isolate::GetCurrent();
+	Isolate* isolate = args.GetIsolate();
 	HandleScope scope(isolate);
 	Recognizer* instance = node::ObjectWrap::Unwrap<Recognizer>(args.Holder());
 
 	if(args.Length() < 1) {
-		//isolate->ThrowException(Exception::TypeError(String::NewFromUtf8(isolate, "Incorrect number of arguments, expected boolean")));
-		Recognizer::TypeError(instance, isolate, String::NewFromUtf8(isolate, "Incorrect number of arguments, expected boolean"));
+		//isolate->ThrowException(Exception::TypeError(NewString(isolate, "Incorrect number of arguments, expected boolean")));
+		Recognizer::TypeError(instance, isolate, "Incorrect number of arguments, expected boolean");
 		args.GetReturnValue().Set(Undefined(isolate));
 		return;
 	}
 
 	if(!args[0]->IsBoolean()) {
-		//isolate->ThrowException(Exception::TypeError(String::NewFromUtf8(isolate, "Expected enabled to be a boolean")));
-		Recognizer::TypeError(instance, isolate, String::NewFromUtf8(isolate, "Expected enabled to be a boolean"));
+		//isolate->ThrowException(Exception::TypeError(NewString(isolate, "Expected enabled to be a boolean")));
+		Recognizer::TypeError(instance, isolate, "Expected enabled to be a boolean");
 		args.GetReturnValue().Set(Undefined(isolate));
 		return;
 	}
 
-	instance->silenceDetection = args[0]->BooleanValue();
+	instance->silenceDetection = args[0]->BooleanValue(isolate);
+}
+
+void Recognizer::Endpointer(const FunctionCallbackInfo<Value>& args) {
+	Isolate* isolate = args.GetIsolate();
+	HandleScope scope(isolate);
+	Local<Context> context = isolate->GetCurrentContext();
+	Recognizer* instance = node::ObjectWrap::Unwrap<Recognizer>(args.Holder());
+
+	if(args.Length() < 1) {
+		Recognizer::TypeError(instance, isolate, "Incorrect number of arguments, expected options or false");
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	if(args[0]->IsBoolean() && !args[0]->BooleanValue(isolate)) {
+		instance->endpoint.Disable();
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	if(!args[0]->IsObject()) {
+		Recognizer::TypeError(instance, isolate, "Expected options to be an object or false");
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	Local<Object> options = args[0].As<Object>();
+	Local<Value> trailingSilence = Default(options->Get(context, NewString(isolate, "trailingSilence")).ToLocalChecked(), Number::New(isolate, 500));
+	Local<Value> minSpeech = Default(options->Get(context, NewString(isolate, "minSpeech")).ToLocalChecked(), Number::New(isolate, 100));
+	Local<Value> maxUtterance = Default(options->Get(context, NewString(isolate, "maxUtterance")).ToLocalChecked(), Number::New(isolate, 0));
+
+	if(!trailingSilence->IsNumber() || !minSpeech->IsNumber() || !maxUtterance->IsNumber()) {
+		Recognizer::TypeError(instance, isolate, "Expected trailingSilence, minSpeech and maxUtterance to be milliseconds");
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	instance->endpoint.Enable(trailingSilence->NumberValue(context).FromJust(),
+		minSpeech->NumberValue(context).FromJust(),
+		maxUtterance->NumberValue(context).FromJust());
+
+	args.GetReturnValue().Set(args.Holder());
+}
+
+void Recognizer::Pipeline(const FunctionCallbackInfo<Value>& args) {
+	Isolate* isolate = args.GetIsolate();
+	HandleScope scope(isolate);
+	Local<Context> context = isolate->GetCurrentContext();
+	Recognizer* instance = node::ObjectWrap::Unwrap<Recognizer>(args.Holder());
+
+	if(!Ready(instance, isolate)) {
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	if(args.Length() < 1) {
+		Recognizer::TypeError(instance, isolate, "Incorrect number of arguments, expected options or false");
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	if(args[0]->IsBoolean() && !args[0]->BooleanValue(isolate)) {
+		instance->rescoreLm = NULL;
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	if(!args[0]->IsObject()) {
+		Recognizer::TypeError(instance, isolate, "Expected options to be an object or false");
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	Local<Object> options = args[0].As<Object>();
+	cmd_ln_t* config = ps_get_config(instance->ps);
+	Local<Value> lm = options->Get(context, NewString(isolate, "lm")).ToLocalChecked();
+	Local<Value> lw = Default(options->Get(context, NewString(isolate, "lw")).ToLocalChecked(), Number::New(isolate, cmd_ln_float32_r(config, "-lw")));
+	Local<Value> instances = Default(options->Get(context, NewString(isolate, "instances")).ToLocalChecked(), Number::New(isolate, 2));
+
+	if(!lm->IsString() || !lw->IsNumber() || !instances->IsUint32() || instances->Uint32Value(context).FromJust() < 1) {
+		Recognizer::TypeError(instance, isolate, "Expected lm to be a string, lw to be a number and instances to be a positive integer");
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	// The model itself is loaded by the first rescoring jobs, off the loop thread
+	instance->rescoreLm = SharedModels::Ngram(*String::Utf8Value(isolate, lm), cmd_ln_float_r(config, "-logbase"));
+	SharedModels::SetLimit(instance->rescoreLm, instances->Uint32Value(context).FromJust());
+	instance->rescoreLw = float32(lw->NumberValue(context).FromJust());
+
+	args.GetReturnValue().Set(args.Holder());
+}
+
+void Recognizer::AdaptivePruning(const FunctionCallbackInfo<Value>& args) {
+	Isolate* isolate = args.GetIsolate();
+	HandleScope scope(isolate);
+	Local<Context> context = isolate->GetCurrentContext();
+	Recognizer* instance = node::ObjectWrap::Unwrap<Recognizer>(args.Holder());
+
+	if(!Ready(instance, isolate)) {
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	if(args.Length() < 1) {
+		Recognizer::TypeError(instance, isolate, "Incorrect number of arguments, expected options or false");
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	// The configured beams come back with the next utterance
+	if(args[0]->IsBoolean() && !args[0]->BooleanValue(isolate)) {
+		instance->pruning.Disable();
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	if(!args[0]->IsObject()) {
+		Recognizer::TypeError(instance, isolate, "Expected options to be an object or false");
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	Local<Object> options = args[0].As<Object>();
+	Local<Value> target = Default(options->Get(context, NewString(isolate, "target")).ToLocalChecked(), Number::New(isolate, 0.5));
+	Local<Value> maxLevel = Default(options->Get(context, NewString(isolate, "maxLevel")).ToLocalChecked(), Number::New(isolate, 4));
+
+	if(!target->IsNumber() || target->NumberValue(context).FromJust() <= 0 || !maxLevel->IsUint32()) {
+		Recognizer::TypeError(instance, isolate, "Expected target to be a positive number and maxLevel to be a positive integer");
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	instance->pruning.Enable(instance->ps, target->NumberValue(context).FromJust(), int(maxLevel->Uint32Value(context).FromJust()));
+
+	args.GetReturnValue().Set(args.Holder());
+}
+
+void Recognizer::PruningStats(const FunctionCallbackInfo<Value>& args) {
+	Isolate* isolate = args.GetIsolate();
+	HandleScope scope(isolate);
+	Local<Context> context = isolate->GetCurrentContext();
+	Recognizer* instance = node::ObjectWrap::Unwrap<Recognizer>(args.Holder());
+	PruningController& pruning = instance->pruning;
+
+	Local<Object> stats = Object::New(isolate);
+	stats->Set(context, NewString(isolate, "enabled"), Boolean::New(isolate, pruning.Enabled())).Check();
+	stats->Set(context, NewString(isolate, "target"), Number::New(isolate, pruning.Target())).Check();
+	stats->Set(context, NewString(isolate, "rtf"), Number::New(isolate, pruning.RealTimeFactor())).Check();
+	stats->Set(context, NewString(isolate, "level"), Integer::New(isolate, pruning.Level())).Check();
+	stats->Set(context, NewString(isolate, "pending"), Boolean::New(isolate, pruning.Pending())).Check();
+	stats->Set(context, NewString(isolate, "adjustments"), Number::New(isolate, pruning.Adjustments())).Check();
+	stats->Set(context, NewString(isolate, "beam"), Number::New(isolate, pruning.Beam())).Check();
+	stats->Set(context, NewString(isolate, "wbeam"), Number::New(isolate, pruning.WordBeam())).Check();
+	stats->Set(context, NewString(isolate, "pbeam"), Number::New(isolate, pruning.PhoneBeam())).Check();
+	stats->Set(context, NewString(isolate, "maxhmmpf"), Number::New(isolate, double(pruning.MaxHmmPerFrame()))).Check();
+
+	args.GetReturnValue().Set(stats);
+}
+
+void Recognizer::Qos(const FunctionCallbackInfo<Value>& args) {
+	Isolate* isolate = args.GetIsolate();
+	HandleScope scope(isolate);
+	Local<Context> context = isolate->GetCurrentContext();
+	Recognizer* instance = node::ObjectWrap::Unwrap<Recognizer>(args.Holder());
+
+	if(args.Length() < 1 || !args[0]->IsObject()) {
+		Recognizer::TypeError(instance, isolate, "Expected options to be an object");
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	Local<Object> options = args[0].As<Object>();
+	Local<Value> priority = Default(options->Get(context, NewString(isolate, "priority")).ToLocalChecked(), Integer::New(isolate, instance->qos.priority));
+	Local<Value> deadline = Default(options->Get(context, NewString(isolate, "deadline")).ToLocalChecked(), Number::New(isolate, instance->qos.deadline));
+
+	if(!priority->IsInt32() || !deadline->IsNumber() || deadline->NumberValue(context).FromJust() < 0) {
+		Recognizer::TypeError(instance, isolate, "Expected priority to be an integer and deadline to be milliseconds");
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	instance->qos.priority = priority->Int32Value(context).FromJust();
+	instance->qos.deadline = deadline->NumberValue(context).FromJust();
+
+	args.GetReturnValue().Set(args.Holder());
 }
 
 void Recognizer::On(const FunctionCallbackInfo<Value>& args) {
-	Isolate* isolate = Isolate::GetCurrent();
+	Isolate* isolate = args.GetIsolate();
 	HandleScope scope(isolate);
 	Recognizer* instance = node::ObjectWrap::Unwrap<Recognizer>(args.Holder());
 
 	if(args.Length() < 2) {
-		//isolate->ThrowException(Exception::TypeError(String::NewFromUtf8(isolate, "Incorrect number of arguments, expected event and callback")));
-		Recognizer::TypeError(instance, isolate, String::NewFromUtf8(isolate, "Incorrect number of arguments, expected event and callback"));
+		//isolate->ThrowException(Exception::TypeError(NewString(isolate, "Incorrect number of arguments, expected event and callback")));
+		Recognizer::TypeError(instance, isolate, "Incorrect number of arguments, expected event and callback");
 		args.GetReturnValue().Set(Undefined(isolate));
 		return;
 	}
 
 	if(!args[0]->IsString()) {
-		//isolate->ThrowException(Exception::TypeError(String::NewFromUtf8(isolate, "Expected event to be a string")));
-		Recognizer::TypeError(instance, isolate, String::NewFromUtf8(isolate, "Expected event to be a string"));
+		//isolate->ThrowException(Exception::TypeError(NewString(isolate, "Expected event to be a string")));
+		Recognizer::TypeError(instance, isolate, "Expected event to be a string");
 		args.GetReturnValue().Set(Undefined(isolate));
 		return;
 	}
 
 	if(!args[1]->IsFunction()) {
-		//isolate->ThrowException(Exception::TypeError(String::NewFromUtf8(isolate, "Expected callback to be a function")));
-		Recognizer::TypeError(instance, isolate, String::NewFromUtf8(isolate, "Expected callback to be a function"));
+		//isolate->ThrowException(Exception::TypeError(NewString(isolate, "Expected callback to be a function")));
+		Recognizer::TypeError(instance, isolate, "Expected callback to be a function");
 		args.GetReturnValue().Set(Undefined(isolate));
 		return;
 	}
 
-	String::Utf8Value event(args[0]);
+	String::Utf8Value event(isolate, args[0]);
 	Local<Function> cb = Local<Function>::Cast(args[1]);
 
 	if(strcmp(*event, "hyp")==0) {
@@ -264,29 +589,50 @@ void Recognizer::On(const FunctionCallbackInfo<Value>& args) {
 	} else
 	if(strcmp(*event, "error")==0) {
 		instance->errorCallback.Reset(isolate, cb);
+	} else
+	if(strcmp(*event, "endpoint")==0) {
+		instance->endpointCallback.Reset(isolate, cb);
+	} else
+	if(strcmp(*event, "hypRescored")==0) {
+		instance->hypRescoredCallback.Reset(isolate, cb);
+	} else
+	if(strcmp(*event, "keyword")==0) {
+		instance->keywordCallback.Reset(isolate, cb);
+	} else
+	if(strcmp(*event, "dropped")==0) {
+		instance->droppedCallback.Reset(isolate, cb);
+	} else
+	if(strcmp(*event, "late")==0) {
+		instance->lateCallback.Reset(isolate, cb);
+	} else
+	if(strcmp(*event, "hibernated")==0) {
+		instance->hibernatedCallback.Reset(isolate, cb);
+	} else
+	if(strcmp(*event, "restored")==0) {
+		instance->restoredCallback.Reset(isolate, cb);
 	}
 }
 
 void Recognizer::Off(const FunctionCallbackInfo<Value>& args) {
-	Isolate* isolate = Isolate::GetCurrent();
+	Isolate* isolate = args.GetIsolate();
 	HandleScope scope(isolate);
 	Recognizer* instance = node::ObjectWrap::Unwrap<Recognizer>(args.Holder());
 
 	if(args.Length() < 1) {
-		//isolate->ThrowException(Exception::TypeError(String::NewFromUtf8(isolate, "Incorrect number of arguments, expected event and callback")));
-		Recognizer::TypeError(instance, isolate, String::NewFromUtf8(isolate, "Incorrect number of arguments, expected event and callback"));
+		//isolate->ThrowException(Exception::TypeError(NewString(isolate, "Incorrect number of arguments, expected event and callback")));
+		Recognizer::TypeError(instance, isolate, "Incorrect number of arguments, expected event and callback");
 		args.GetReturnValue().Set(Undefined(isolate));
 		return;
 	}
 	if(!args[0]->IsString()) {
-		//isolate->ThrowException(Exception::TypeError(String::NewFromUtf8(isolate, "Expected event to be a string")));
-		Recognizer::TypeError(instance, isolate, String::NewFromUtf8(isolate, "Expected event to be a string"));
+		//isolate->ThrowException(Exception::TypeError(NewString(isolate, "Expected event to be a string")));
+		Recognizer::TypeError(instance, isolate, "Expected event to be a string");
 		args.GetReturnValue().Set(Undefined(isolate));
 		return;
 	}
-	String::Utf8Value event(args[0]);
+	String::Utf8Value event(isolate, args[0]);
 
-	Handle<Function> emptyFoo = Handle<Function>();
+	Local<Function> emptyFoo = Local<Function>();
 	if(strcmp(*event, "hyp")==0) {
 		instance->hypCallback.Reset(isolate, emptyFoo);
 	} else 
@@ -307,386 +653,514 @@ void Recognizer::Off(const FunctionCallbackInfo<Value>& args) {
 	} else
 	if(strcmp(*event, "error")==0) {
 		instance->errorCallback.Reset(isolate, emptyFoo);
+	} else
+	if(strcmp(*event, "endpoint")==0) {
+		instance->endpointCallback.Reset(isolate, emptyFoo);
+	} else
+	if(strcmp(*event, "hypRescored")==0) {
+		instance->hypRescoredCallback.Reset(isolate, emptyFoo);
+	} else
+	if(strcmp(*event, "keyword")==0) {
+		instance->keywordCallback.Reset(isolate, emptyFoo);
+	} else
+	if(strcmp(*event, "dropped")==0) {
+		instance->droppedCallback.Reset(isolate, emptyFoo);
+	} else
+	if(strcmp(*event, "late")==0) {
+		instance->lateCallback.Reset(isolate, emptyFoo);
+	} else
+	if(strcmp(*event, "hibernated")==0) {
+		instance->hibernatedCallback.Reset(isolate, emptyFoo);
+	} else
+	if(strcmp(*event, "restored")==0) {
+		instance->restoredCallback.Reset(isolate, emptyFoo);
 	}
 }
 
 void Recognizer::AddKeyphraseSearch(const FunctionCallbackInfo<Value>& args) {
-	Isolate* isolate = Isolate::GetCurrent();
+	Isolate* isolate = args.GetIsolate();
 	HandleScope scope(isolate);
 	Recognizer* instance = node::ObjectWrap::Unwrap<Recognizer>(args.Holder());
 
+	if(!Ready(instance, isolate)) {
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
 	if(args.Length() < 2) {
-		//isolate->ThrowException(Exception::TypeError(String::NewFromUtf8(isolate, "Incorrect number of arguments, expected name and keyphrase")));
-		Recognizer::TypeError(instance, isolate, String::NewFromUtf8(isolate, "Incorrect number of arguments, expected name and keyphrase"));
+		//isolate->ThrowException(Exception::TypeError(NewString(isolate, "Incorrect number of arguments, expected name and keyphrase")));
+		Recognizer::TypeError(instance, isolate, "Incorrect number of arguments, expected name and keyphrase");
 		args.GetReturnValue().Set(args.Holder());
 		return;
 	}
 
 	if(!args[0]->IsString() || !args[1]->IsString()) {
-		//isolate->ThrowException(Exception::TypeError(String::NewFromUtf8(isolate, "Expected both name and keyphrase to be strings")));
-		Recognizer::TypeError(instance, isolate, String::NewFromUtf8(isolate, "Expected both name and keyphrase to be strings"));
+		//isolate->ThrowException(Exception::TypeError(NewString(isolate, "Expected both name and keyphrase to be strings")));
+		Recognizer::TypeError(instance, isolate, "Expected both name and keyphrase to be strings");
 		args.GetReturnValue().Set(args.Holder());
 		return;
 	}
 
-	String::Utf8Value name(args[0]);
-	String::Utf8Value keyphrase(args[1]);
+	String::Utf8Value name(isolate, args[0]);
+	String::Utf8Value keyphrase(isolate, args[1]);
 
 	int result = ps_set_keyphrase(instance->ps, *name, *keyphrase);
+	if(result >= 0)
+		RememberSearch(instance, SEARCH_KEYPHRASE, *name, *keyphrase);
 	if(result < 0)
-		Recognizer::Error(instance, isolate, String::NewFromUtf8(isolate, "Failed to add keyphrase search to recognizer"));
-		//isolate->ThrowException(Exception::Error(String::NewFromUtf8(isolate, "Failed to add keyphrase search to recognizer")));
+		Recognizer::Error(instance, isolate, "Failed to add keyphrase search to recognizer");
+		//isolate->ThrowException(Exception::Error(NewString(isolate, "Failed to add keyphrase search to recognizer")));
 
 	args.GetReturnValue().Set(args.Holder());
 }
 
 void Recognizer::AddKeywordsSearch(const FunctionCallbackInfo<Value>& args) {
-	Isolate* isolate = Isolate::GetCurrent();
+	Isolate* isolate = args.GetIsolate();
 	HandleScope scope(isolate);
 	Recognizer* instance = node::ObjectWrap::Unwrap<Recognizer>(args.Holder());
 
+	if(!Ready(instance, isolate)) {
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
 	if(args.Length() < 2) {
-		//isolate->ThrowException(Exception::TypeError(String::NewFromUtf8(isolate, "Incorrect number of arguments, expected name and file")));
-		Recognizer::TypeError(instance, isolate, String::NewFromUtf8(isolate, "Incorrect number of arguments, expected name and file"));
+		//isolate->ThrowException(Exception::TypeError(NewString(isolate, "Incorrect number of arguments, expected name and file")));
+		Recognizer::TypeError(instance, isolate, "Incorrect number of arguments, expected name and file");
 		args.GetReturnValue().Set(args.Holder());
 		return;
 	}
 
 	if(!args[0]->IsString() || !args[1]->IsString()) {
-		//isolate->ThrowException(Exception::TypeError(String::NewFromUtf8(isolate, "Expected both name and file to be strings")));
-		Recognizer::TypeError(instance, isolate, String::NewFromUtf8(isolate, "Expected both name and file to be strings"));
+		//isolate->ThrowException(Exception::TypeError(NewString(isolate, "Expected both name and file to be strings")));
+		Recognizer::TypeError(instance, isolate, "Expected both name and file to be strings");
 		args.GetReturnValue().Set(args.Holder());
 		return;
 	}
 
-	String::Utf8Value name(args[0]);
-	String::Utf8Value file(args[1]);
+	String::Utf8Value name(isolate, args[0]);
+	String::Utf8Value file(isolate, args[1]);
 
 	int result = ps_set_kws(instance->ps, *name, *file);
+	if(result >= 0)
+		RememberSearch(instance, SEARCH_KEYWORDS, *name, *file);
 	if(result < 0)
-		Recognizer::Error(instance, isolate, String::NewFromUtf8(isolate, "Failed to add keywords search to recognizer"));
-		//isolate->ThrowException(Exception::Error(String::NewFromUtf8(isolate, "Failed to add keywords search to recognizer")));
+		Recognizer::Error(instance, isolate, "Failed to add keywords search to recognizer");
+		//isolate->ThrowException(Exception::Error(NewString(isolate, "Failed to add keywords search to recognizer")));
 
 	args.GetReturnValue().Set(args.Holder());
 }
 
 void Recognizer::AddGrammarSearch(const FunctionCallbackInfo<Value>& args) {
-	Isolate* isolate = Isolate::GetCurrent();
+	Isolate* isolate = args.GetIsolate();
 	HandleScope scope(isolate);
 	Recognizer* instance = node::ObjectWrap::Unwrap<Recognizer>(args.Holder());
 
+	if(!Ready(instance, isolate)) {
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
 	if(args.Length() < 2) {
-		//isolate->ThrowException(Exception::TypeError(String::NewFromUtf8(isolate, "Incorrect number of arguments, expected name and file")));
-		Recognizer::TypeError(instance, isolate, String::NewFromUtf8(isolate, "Incorrect number of arguments, expected name and file"));
+		//isolate->ThrowException(Exception::TypeError(NewString(isolate, "Incorrect number of arguments, expected name and file")));
+		Recognizer::TypeError(instance, isolate, "Incorrect number of arguments, expected name and file");
 		args.GetReturnValue().Set(args.Holder());
 	}
 
 	if(!args[0]->IsString() || !args[1]->IsString()) {
-		//isolate->ThrowException(Exception::TypeError(String::NewFromUtf8(isolate, "Expected both name and file to be strings")));
-		Recognizer::TypeError(instance, isolate, String::NewFromUtf8(isolate, "Expected both name and file to be strings"));
+		//isolate->ThrowException(Exception::TypeError(NewString(isolate, "Expected both name and file to be strings")));
+		Recognizer::TypeError(instance, isolate, "Expected both name and file to be strings");
 		args.GetReturnValue().Set(args.Holder());
 	}
 
-	String::Utf8Value name(args[0]);
-	String::Utf8Value file(args[1]);
+	String::Utf8Value name(isolate, args[0]);
+	String::Utf8Value file(isolate, args[1]);
 
 	int result = ps_set_jsgf_file(instance->ps, *name, *file);
+	if(result >= 0)
+		RememberSearch(instance, SEARCH_GRAMMAR, *name, *file);
 	if(result < 0)
-		Recognizer::Error(instance, isolate, String::NewFromUtf8(isolate, "Failed to add grammar search to recognizer"));
-		//isolate->ThrowException(Exception::Error(String::NewFromUtf8(isolate, "Failed to add grammar search to recognizer")));
+		Recognizer::Error(instance, isolate, "Failed to add grammar search to recognizer");
+		//isolate->ThrowException(Exception::Error(NewString(isolate, "Failed to add grammar search to recognizer")));
 
 	args.GetReturnValue().Set(args.Holder());
 }
 
 void Recognizer::AddNgramSearch(const FunctionCallbackInfo<Value>& args) {
-	Isolate* isolate = Isolate::GetCurrent();
+	Isolate* isolate = args.GetIsolate();
 	HandleScope scope(isolate);
 	Recognizer* instance = node::ObjectWrap::Unwrap<Recognizer>(args.Holder());
 
+	if(!Ready(instance, isolate)) {
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
 	if(args.Length() < 2) {
-		//isolate->ThrowException(Exception::TypeError(String::NewFromUtf8(isolate, "Incorrect number of arguments, expected name and file")));
-		Recognizer::TypeError(instance, isolate, String::NewFromUtf8(isolate, "Incorrect number of arguments, expected name and file"));
+		//isolate->ThrowException(Exception::TypeError(NewString(isolate, "Incorrect number of arguments, expected name and file")));
+		Recognizer::TypeError(instance, isolate, "Incorrect number of arguments, expected name and file");
 		args.GetReturnValue().Set(args.Holder());
 		return;
 	}
 
 	if(!args[0]->IsString() || !args[1]->IsString()) {
-		//isolate->ThrowException(Exception::TypeError(String::NewFromUtf8(isolate, "Expected both name and file to be strings")));
-		Recognizer::TypeError(instance, isolate, String::NewFromUtf8(isolate, "Expected both name and file to be strings"));
+		//isolate->ThrowException(Exception::TypeError(NewString(isolate, "Expected both name and file to be strings")));
+		Recognizer::TypeError(instance, isolate, "Expected both name and file to be strings");
 		args.GetReturnValue().Set(args.Holder());
 		return;
 	}
 
-	String::Utf8Value name(args[0]);
-	String::Utf8Value file(args[1]);
+	String::Utf8Value name(isolate, args[0]);
+	String::Utf8Value file(isolate, args[1]);
 
-	int result = ps_set_lm_file(instance->ps, *name, *file);
+	// Load the binary version from the model cache when it was converted already
+	string path = CachedNgram(instance->addon, *file);
+	int result = ps_set_lm_file(instance->ps, *name, path.c_str());
+	if(result >= 0)
+		RememberSearch(instance, SEARCH_NGRAM, *name, *file);
 	if(result < 0)
-		Recognizer::Error(instance, isolate, String::NewFromUtf8(isolate, "Failed to add Ngram search to recognizer"));
-		//isolate->ThrowException(Exception::Error(String::NewFromUtf8(isolate, "Failed to add Ngram search to recognizer")));
+		Recognizer::Error(instance, isolate, "Failed to add Ngram search to recognizer");
+		//isolate->ThrowException(Exception::Error(NewString(isolate, "Failed to add Ngram search to recognizer")));
 
 	args.GetReturnValue().Set(args.Holder());
 }
 
-void Recognizer::GetSearch(Local<String> property, const PropertyCallbackInfo<Value>& args) {
-	Isolate* isolate = Isolate::GetCurrent();
-	Recognizer* instance = node::ObjectWrap::Unwrap<Recognizer>(args.This());
+void Recognizer::SetKeywords(const FunctionCallbackInfo<Value>& args) {
+	Isolate* isolate = args.GetIsolate();
+	HandleScope scope(isolate);
+	Local<Context> context = isolate->GetCurrentContext();
+	Recognizer* instance = node::ObjectWrap::Unwrap<Recognizer>(args.Holder());
 
-	Local<Value> search = String::NewFromUtf8(isolate,ps_get_search(instance->ps));
+	// The list may be the active search
+	if(!Ready(instance, isolate)) {
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
 
-	args.GetReturnValue().Set(search);
-}
+	if(args.Length() < 2) {
+		Recognizer::TypeError(instance, isolate, "Incorrect number of arguments, expected name and keywords");
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
 
-void Recognizer::SetSearch(Local<String> property, Local<Value> value, const PropertyCallbackInfo<void>& args) {
-	Recognizer* instance = node::ObjectWrap::Unwrap<Recognizer>(args.This());
+	if(!args[0]->IsString() || !args[1]->IsArray()) {
+		Recognizer::TypeError(instance, isolate, "Expected name to be a string and keywords to be an array");
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
 
-	String::Utf8Value search(value);
+	Local<Array> keywords = Local<Array>::Cast(args[1]);
+	Local<String> phraseKey = NewString(isolate, "phrase");
+	Local<String> thresholdKey = NewString(isolate, "threshold");
+
+	// Validate everything before touching the current list
+	KeywordList list;
+	for(uint32_t i = 0; i < keywords->Length(); i++) {
+		Local<Value> entry = keywords->Get(context, i).ToLocalChecked();
+		Local<Value> phrase = entry->IsObject() ? entry.As<Object>()->Get(context, phraseKey).ToLocalChecked() : Local<Value>::Cast(Undefined(isolate));
+		Local<Value> threshold = entry->IsObject() ? Default(entry.As<Object>()->Get(context, thresholdKey).ToLocalChecked(), Number::New(isolate, 1)) : Local<Value>::Cast(Undefined(isolate));
+		if(!phrase->IsString() || !threshold->IsNumber()) {
+			Recognizer::TypeError(instance, isolate, "Expected keywords to be objects with a phrase string and a threshold number");
+			args.GetReturnValue().Set(args.Holder());
+			return;
+		}
+		string words;
+		if(!KeywordPhrase(instance, isolate, *String::Utf8Value(isolate, phrase), threshold->NumberValue(context).FromJust(), &words)) {
+			args.GetReturnValue().Set(args.Holder());
+			return;
+		}
+		list.Set(words, threshold->NumberValue(context).FromJust());
+	}
 
-	ps_set_search(instance->ps, *search);
+	String::Utf8Value name(isolate, args[0]);
+	instance->keywordLists[*name] = list;
 
 	args.GetReturnValue().Set(args.Holder());
 }
 
-void Recognizer::Start(const FunctionCallbackInfo<Value>& args) {
-	Isolate* isolate = Isolate::GetCurrent();
+void Recognizer::AddKeyword(const FunctionCallbackInfo<Value>& args) {
+	Isolate* isolate = args.GetIsolate();
+	HandleScope scope(isolate);
+	Local<Context> context = isolate->GetCurrentContext();
 	Recognizer* instance = node::ObjectWrap::Unwrap<Recognizer>(args.Holder());
 
-	if(instance->processing == false) {
-		int result = ps_start_utt(instance->ps);
-		if(result) {
-			//isolate->ThrowException(Exception::Error(String::NewFromUtf8(isolate, "Failed to start PocketSphinx processing")));
-			Recognizer::Error(instance, isolate, String::NewFromUtf8(isolate, "Failed to start PocketSphinx processing"));
-		} else {
-			instance->processing = true;
+	if(args.Length() < 2) {
+		Recognizer::TypeError(instance, isolate, "Incorrect number of arguments, expected name, phrase and threshold");
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
 
-			// Trigger start callback
-			if(!instance->startCallback.IsEmpty()) {
-				Handle<Value> argv[0] = {};
-				Local<Function> cb = Local<Function>::New(isolate, instance->startCallback);
-				cb->Call(isolate->GetCurrentContext()->Global(), 0, argv);
-			}
-		}
-	} else {
-		//isolate->ThrowException(Exception::Error(String::NewFromUtf8(isolate, "PocketSphinx processing seems to run already")));
-		Recognizer::Error(instance, isolate, String::NewFromUtf8(isolate, "PocketSphinx processing seems to run already"));
+	Local<Value> threshold = args.Length() >= 3 ? args[2] : Local<Value>::Cast(Number::New(isolate, 1));
+	if(!args[0]->IsString() || !args[1]->IsString() || !threshold->IsNumber()) {
+		Recognizer::TypeError(instance, isolate, "Expected name and phrase to be strings and threshold to be a number");
+		args.GetReturnValue().Set(args.Holder());
+		return;
 	}
 
-	args.GetReturnValue().Set(args.Holder());
+	string words;
+	if(!KeywordPhrase(instance, isolate, *String::Utf8Value(isolate, args[1]), threshold->NumberValue(context).FromJust(), &words)) {
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	String::Utf8Value name(isolate, args[0]);
+	// Only marks the list, it is rebuilt once when it is used next
+	instance->keywordLists[*name].Set(words, threshold->NumberValue(context).FromJust());
 
-	// Reset silence detection
-	instance->speechDetected = false;
+	args.GetReturnValue().Set(args.Holder());
 }
 
-void Recognizer::Stop(const FunctionCallbackInfo<Value>& args) {
-	Isolate* isolate = Isolate::GetCurrent();
+void Recognizer::RemoveKeyword(const FunctionCallbackInfo<Value>& args) {
+	Isolate* isolate = args.GetIsolate();
+	HandleScope scope(isolate);
 	Recognizer* instance = node::ObjectWrap::Unwrap<Recognizer>(args.Holder());
 
-	if(instance->processing == true) {
-
-		// Fetch hyp with isFinal flag
-		// ..and trigger hypFinal callback
-		if(!instance->hypFinalCallback.IsEmpty()) {
-			int32 isFinal;
-			const char* hyp = ps_get_hyp_final(instance->ps, &isFinal);
-			Handle<Value> argv[3] = { Null(isolate), hyp ? String::NewFromUtf8(isolate,hyp) : String::NewFromUtf8(isolate, ""), NumberObject::New(isolate, isFinal)};
-		
-			Local<Function> cb = Local<Function>::New(isolate, instance->hypFinalCallback);
-			cb->Call(isolate->GetCurrentContext()->Global(), 3, argv);
-		}
+	if(args.Length() < 2) {
+		Recognizer::TypeError(instance, isolate, "Incorrect number of arguments, expected name and phrase");
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
 
-		// End the utterance
-		int result = ps_end_utt(instance->ps);
-		if(result){
-			//isolate->ThrowException(Exception::Error(String::NewFromUtf8(isolate, "Failed to end PocketSphinx processing")));
-			Recognizer::Error(instance, isolate, String::NewFromUtf8(isolate, "Failed to end PocketSphinx processing"));
-		} else {
-			//cout << "Utt successfully stopped..." << endl;
-			instance->processing = false;
-
-			// Trigger stop callback
-			if(!instance->stopCallback.IsEmpty()) {
-				Handle<Value> argv[0] = {};
-				Local<Function> cb = Local<Function>::New(isolate, instance->stopCallback);
-				cb->Call(isolate->GetCurrentContext()->Global(), 0, argv);
-			}
-		}
+	if(!args[0]->IsString() || !args[1]->IsString()) {
+		Recognizer::TypeError(instance, isolate, "Expected both name and phrase to be strings");
+		args.GetReturnValue().Set(args.Holder());
+		return;
 	}
 
-	args.GetReturnValue().Set(args.Holder());
+	String::Utf8Value name(isolate, args[0]);
+	string words;
+
+	// Phrases are stored the way they were added, with single spaces
+	map<string, KeywordList>::iterator it = instance->keywordLists.find(*name);
+	bool removed = it != instance->keywordLists.end() && KeywordList::Normalize(*String::Utf8Value(isolate, args[1]), &words) && it->second.Remove(words);
+	args.GetReturnValue().Set(Boolean::New(isolate, removed));
 }
 
-void Recognizer::Restart(const FunctionCallbackInfo<Value>& args) {
-	Isolate* isolate = Isolate::GetCurrent();
-	Recognizer* instance = node::ObjectWrap::Unwrap<Recognizer>(args.Holder());
+void Recognizer::GetSearch(Local<String> property, const PropertyCallbackInfo<Value>& args) {
+	Isolate* isolate = args.GetIsolate();
+	Recognizer* instance = node::ObjectWrap::Unwrap<Recognizer>(args.This());
 
-	if(instance->processing == true) {
-		// Try stop processing
-		int result = ps_end_utt(instance->ps);
-		if(result) {
-			//isolate->ThrowException(Exception::Error(String::NewFromUtf8(isolate, "Failed to restart PocketSphinx processing")));
-			Recognizer::Error(instance, isolate, String::NewFromUtf8(isolate, "Failed to restart PocketSphinx processing"));
-		} else {
-			instance->processing = false;
+	if(instance->destructed)
+		return;
 
-			// Trigger stop callback
-			if(!instance->stopCallback.IsEmpty()) {
-				Handle<Value> argv[0] = {};
-				Local<Function> cb = Local<Function>::New(isolate, instance->stopCallback);
-				cb->Call(isolate->GetCurrentContext()->Global(), 0, argv);
-			}
+	// Reading the name never wakes a hibernated decoder
+	Local<Value> search = NewString(isolate, ActiveSearch(instance));
 
-			// Restart it now that it's stopped
-			Start(args);
-		}
-	} else {
-		// Start processing
-		Start(args);
-	}
+	args.GetReturnValue().Set(search);
+}
+
+void Recognizer::SetSearch(Local<String> property, Local<Value> value, const PropertyCallbackInfo<void>& args) {
+	Isolate* isolate = args.GetIsolate();
+	Recognizer* instance = node::ObjectWrap::Unwrap<Recognizer>(args.This());
+
+	if(!Ready(instance, isolate))
+		return;
+
+	String::Utf8Value search(isolate, value);
+
+	// Keyword lists are built when they are selected
+	if(instance->keywordLists.count(*search) && !ApplyKeywords(instance, isolate, *search))
+		return;
+
+	ps_set_search(instance->ps, *search);
+	instance->recorder.Control(SESSION_SEARCH, *search);
+	// The selected search has the configured beams, not those of the pruning level
+	instance->pruning.SearchChanged();
 
 	args.GetReturnValue().Set(args.Holder());
 }
 
-void Recognizer::Write(const FunctionCallbackInfo<Value>& args) {
-	Isolate* isolate = Isolate::GetCurrent();
-	Recognizer* instance = node::ObjectWrap::Unwrap<Recognizer>(args.Holder());
-
-	Handle<Object> buffer = args[0]->ToObject();
+void Recognizer::UpdateMemory(Recognizer* instance) {
+	int decoders = 0;
+	int64_t bytes = 0;
+	if(!instance->destructed && instance->ps != NULL) {
+		// All decoders of a Recognizer load the same models
+		decoders = 1 + int(instance->channelDecoders.size());
+		bytes = MemoryTracker::Estimate(ps_get_config(instance->ps)) * decoders;
+	}
 
-	if(!args.Length()) {
-		//isolate->ThrowException(Exception::TypeError(String::NewFromUtf8(isolate, "Expected a data buffer to be provided")));
-		Recognizer::Error(instance, isolate, String::NewFromUtf8(isolate, "Expected a data buffer to be provided"));
-		args.GetReturnValue().Set(args.Holder());
+	int64_t delta = bytes - instance->externalMemory;
+	MemoryTracker::Adjust(decoders - instance->trackedDecoders, delta);
+	// Wrappers finalized after the environment was torn down have no isolate to tell
+	if(delta != 0 && instance->addon != NULL) {
+		instance->addon->isolate->AdjustAmountOfExternalAllocatedMemory(delta);
 	}
+	instance->externalMemory = bytes;
+	instance->trackedDecoders = decoders;
+}
 
-	if(!node::Buffer::HasInstance(buffer)) {
-		/*
-		Local<Value> argv[1] = { Exception::Error(String::NewFromUtf8(isolate, "Expected data to be a buffer")) };
-		Local<Function> cb = Local<Function>::New(isolate, instance->hypCallback);
-		cb->Call(isolate->GetCurrentContext()->Global(), 1, argv);*/
-		Recognizer::Error(instance, isolate, String::NewFromUtf8(isolate, "Expected data to be a buffer"));
-		args.GetReturnValue().Set(args.Holder());
+void Recognizer::RememberSearch(Recognizer* instance, int type, const char* name, const char* argument) {
+	for(size_t i = 0; i < instance->searches.size(); i++) {
+		if(instance->searches[i].name == name) {
+			instance->searches.erase(instance->searches.begin() + i);
+			break;
+		}
 	}
 
-	AsyncData* data = new AsyncData();
-	data->instance = instance;
-	data->data = (int16*) node::Buffer::Data(buffer);
-	data->length = node::Buffer::Length(buffer) / sizeof(int16);
+	SearchDefinition search;
+	search.type = type;
+	search.name = name;
+	search.argument = argument;
+	instance->searches.push_back(search);
+	// Decoders of other channels add it before their next job
+	instance->searchVersion++;
 
-	uv_work_t* req = new uv_work_t();
-	req->data = data;
+	// The replay decoder adds the search as well
+	instance->recorder.Search(type, name, argument);
+}
 
-	uv_queue_work(uv_default_loop(), req, AsyncWorker, (uv_after_work_cb)AsyncAfter);
+void Recognizer::ForgetDecoderState(Recognizer* instance) {
+	instance->searches.clear();
+	instance->searchVersion++;
+	instance->addedWords.clear();
+	InvalidateKeywords(instance);
+}
 
-	args.GetReturnValue().Set(args.Holder());
+void Recognizer::InvalidateKeywords(Recognizer* instance) {
+	for(map<string, KeywordList>::iterator it = instance->keywordLists.begin(); it != instance->keywordLists.end(); ++it) {
+		it->second.Invalidate();
+	}
 }
 
-void Recognizer::WriteSync(const FunctionCallbackInfo<Value>& args) {
-	Isolate* isolate = Isolate::GetCurrent();
-	HandleScope scope(isolate);
-	Recognizer* instance = node::ObjectWrap::Unwrap<Recognizer>(args.Holder());
+void Recognizer::CloseTimer(uv_handle_t* handle) {
+	delete reinterpret_cast<uv_timer_t*>(handle);
+}
 
-	// Skip the buffer when not processing
-	if(instance->processing == false) {
-		//cout << "Buffer recieved but not running..." << endl;
-		return;
+void Recognizer::ReleaseTimer(uv_handle_t* handle) {
+	AddonData* addon = reinterpret_cast<AddonData*>(handle->data);
+	delete reinterpret_cast<uv_timer_t*>(handle);
+	addon->Release();
+}
+
+void Recognizer::Teardown(Recognizer* instance) {
+	// The loop is closed with the environment, the timer can't wait for the wrapper to be collected
+	if(instance->idleTimer != NULL) {
+		instance->addon->Hold();
+		instance->idleTimer->data = instance->addon;
+		uv_close(reinterpret_cast<uv_handle_t*>(instance->idleTimer), ReleaseTimer);
+		instance->idleTimer = NULL;
 	}
+}
 
-	Handle<Object> buffer = args[0]->ToObject();
+bool Recognizer::Ready(Recognizer* instance, Isolate* isolate, bool queued) {
+	if(instance->destructed) {
+		Recognizer::Error(instance, isolate, "Recognizer was freed");
+		return false;
+	}
 
-	if(!args.Length()) {
-		Recognizer::Error(instance, isolate, String::NewFromUtf8(isolate, "Expected data to be a buffer"));
-		//isolate->ThrowException(Exception::TypeError(String::NewFromUtf8(isolate, "Expected a data buffer to be provided")));
-		return;
+	// decodeFile, align and the like run on the decoder until their callback
+	if(instance->busy) {
+		Recognizer::Error(instance, isolate, "Recognizer is busy");
+		return false;
 	}
 
-	if(!node::Buffer::HasInstance(buffer)) {
-		//Local<Value> argv[1] = { Exception::Error(String::NewFromUtf8(isolate, "Expected data to be a buffer")) };
-		Recognizer::Error(instance, isolate, String::NewFromUtf8(isolate, "Expected data to be a buffer"));
-		
-		/*if(!instance->hypCallback.IsEmpty()) {
-			Local<Function> cb = Local<Function>::New(isolate, instance->hypCallback);
-			cb->Call(isolate->GetCurrentContext()->Global(), 1, argv);
-		}*/
-		return;
+	// Only start, restart and writes wait behind the chunks written before them, a restore is queued like them
+	if(!queued && !instance->queue.Idle()) {
+		Recognizer::Error(instance, isolate, "Recognizer is busy decoding written audio");
+		return false;
+	}
+
+	// Queued calls don't need the decoder yet, it is rebuilt on a pool thread ahead of them
+	if(queued) {
+		QueueRestore(instance);
+		return true;
 	}
 
-	int16* data = (int16*) node::Buffer::Data(buffer);
-	size_t length = node::Buffer::Length(buffer) / sizeof(int16);
+	return Wake(instance, isolate);
+}
 
-	if(ps_process_raw(instance->ps, data, length, FALSE, FALSE) < 0) {
-		/*Handle<Value> argv[1] = { Exception::Error(String::NewFromUtf8(isolate, "Failed to process audio data")) };
+void Recognizer::QueueRescore(Recognizer* instance) {
+	ps_lattice_t* dag = ps_get_lattice(instance->ps);
+	if(dag == NULL)
+		return;
 
-		// Trigger hyp callback
-		if(!instance->hypCallback.IsEmpty()) {
-			Local<Function> cb = Local<Function>::New(isolate, instance->hypCallback);
-			cb->Call(isolate->GetCurrentContext()->Global(), 1, argv);
-		}*/
-		Recognizer::Error(instance, isolate, String::NewFromUtf8(isolate, "Failed to process audio data"));
+	// The lattice points into the dictionary and search of the decoder, the job gets a copy
+	// so the next utterance can start right away
+	RescoreData* data = new RescoreData();
+	if(!data->lattice.Copy(dag)) {
+		delete data;
 		return;
 	}
+	data->request.data = data;
+	data->instance = instance;
+	data->lm = instance->rescoreLm;
+	data->lw = instance->rescoreLw;
+	data->error = NULL;
 
-	int32 score;
-	const char* hyp = ps_get_hyp(instance->ps, &score);
+	instance->Ref();
+	instance->addon->Hold();
 
-	// Silence detection
-	if (instance->speechDetected == false && ps_get_in_speech(instance->ps)==1) {
-		instance->speechDetected = true;
-		// Trigger speechDetected callback
-		if(!instance->speechDetectedCallback.IsEmpty()) {
-			Handle<Value> argv[0] = {};
-			Local<Function> cb = Local<Function>::New(isolate, instance->speechDetectedCallback);
-			cb->Call(isolate->GetCurrentContext()->Global(), 1, argv);
-		}
-	}
-	if (instance->speechDetected == true && ps_get_in_speech(instance->ps)==0) {
-		// Trigger silenceDetected callback
-		if(!instance->silenceDetectedCallback.IsEmpty()) {
-			Handle<Value> argv[0] = {};
-			Local<Function> cb = Local<Function>::New(isolate, instance->silenceDetectedCallback);
-			cb->Call(isolate->GetCurrentContext()->Global(), 1, argv);
-		}
-		// Stop decoding when sd is enabled
-		if (instance->silenceDetection) {
-			Stop(args);
-		}
+	uv_queue_work(instance->addon->loop, &data->request, RescoreWorker, (uv_after_work_cb)RescoreAfter);
+}
+
+void Recognizer::RescoreWorker(uv_work_t* request) {
+	RescoreData* data = reinterpret_cast<RescoreData*>(request->data);
+	TraceSpan span("decode", "rescore", data->instance->traceId);
+
+	// Every job borrows a copy of the shared model for itself
+	ngram_model_t* lm = SharedModels::Acquire(data->lm);
+	if(lm == NULL) {
+		data->error = data->lm->error;
+		return;
 	}
 
-	Handle<Value> argv[3] = { Null(isolate), hyp ? String::NewFromUtf8(isolate,hyp) : String::NewFromUtf8(isolate, ""), NumberObject::New(isolate,score)};
-	
-	if(!instance->hypCallback.IsEmpty()) {
-		Local<Function> cb = Local<Function>::New(isolate, instance->hypCallback);
-		cb->Call(isolate->GetCurrentContext()->Global(), 3, argv);
+	data->error = data->lattice.Rescore(lm, data->lw, data->hyp);
+	SharedModels::Release(data->lm, lm);
+}
+
+void Recognizer::RescoreAfter(uv_work_t* request) {
+	RescoreData* data = reinterpret_cast<RescoreData*>(request->data);
+	Recognizer* instance = data->instance;
+	AddonData* addon = instance->addon;
+	Isolate* isolate = addon->isolate;
+	HandleScope scope(isolate);
+
+	if(data->error != NULL) {
+		Recognizer::Error(instance, isolate, data->error);
+	} else {
+		EventArg argv[2];
+		argv[0].SetNull();
+		argv[1].SetString(data->hyp.c_str());
+		Emit(instance, isolate, "hypRescored", instance->hypRescoredCallback, 2, argv);
 	}
 
-	args.GetReturnValue().Set(args.Holder());
+	delete data;
+	instance->Unref();
+	addon->Release();
 }
 
 void Recognizer::LookupWords(const FunctionCallbackInfo<Value>& args) {
-	Isolate* isolate = Isolate::GetCurrent();
+	Isolate* isolate = args.GetIsolate();
 	HandleScope scope(isolate);
+	Local<Context> context = isolate->GetCurrentContext();
 	Recognizer* instance = node::ObjectWrap::Unwrap<Recognizer>(args.Holder());
 
+	if(!Ready(instance, isolate)) {
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
 	if(args.Length() < 1) {
-		//isolate->ThrowException(Exception::TypeError(String::NewFromUtf8(isolate, "Incorrect number of arguments, expected options at least")));
-		Recognizer::TypeError(instance, isolate, String::NewFromUtf8(isolate, "Incorrect number of arguments, expected words"));
+		//isolate->ThrowException(Exception::TypeError(NewString(isolate, "Incorrect number of arguments, expected options at least")));
+		Recognizer::TypeError(instance, isolate, "Incorrect number of arguments, expected words");
 		args.GetReturnValue().Set(Undefined(isolate));
 		return;
 	}
 
 	if(!args[0]->IsArray()) {
-		//isolate->ThrowException(Exception::TypeError(String::NewFromUtf8(isolate, "Expected options to be an object")));
-		Recognizer::TypeError(instance, isolate, String::NewFromUtf8(isolate, "Expected words to be an array"));
+		//isolate->ThrowException(Exception::TypeError(NewString(isolate, "Expected options to be an object")));
+		Recognizer::TypeError(instance, isolate, "Expected words to be an array");
 		args.GetReturnValue().Set(Undefined(isolate));
 		return;
 	}
 
 	vector<string> result;
-    Handle<Value> val;
+    Local<Value> val;
     if (args[0]->IsArray()) {
-		Handle<Array> jsArray = Handle<Array>::Cast(args[0]);
+		Local<Array> jsArray = Local<Array>::Cast(args[0]);
 		for (unsigned int i = 0; i < jsArray->Length(); i++) {
-			val = jsArray->Get(Integer::New(isolate, i)); 
-			result.push_back(string(*String::Utf8Value(val)));
+			val = jsArray->Get(context, Integer::New(isolate, i)).ToLocalChecked(); 
+			result.push_back(string(*String::Utf8Value(isolate, val)));
 		}
 	}
 
@@ -707,105 +1181,162 @@ void Recognizer::LookupWords(const FunctionCallbackInfo<Value>& args) {
     	}
     }
 
-    Handle<Array> out_array = Array::New(isolate, int(non_existing.size()));
-    Handle<Object> in_object = Object::New(isolate);
+    Local<Array> out_array = Array::New(isolate, int(non_existing.size()));
+    Local<Object> in_object = Object::New(isolate);
 	for (unsigned int i = 0; i < non_existing.size(); ++i)
 	{
-		out_array->Set(i, String::NewFromUtf8(isolate, non_existing.at(i).c_str()));
+		out_array->Set(context, i, NewString(isolate, non_existing.at(i).c_str())).Check();
 	}
 	for (unsigned int i = 0; i < existing.size(); ++i)
 	{
-		in_object->Set(
-			String::NewFromUtf8(isolate, existing.at(i).c_str()),
-			String::NewFromUtf8(isolate, transcriptions.at(i).c_str())
-		);
-	}
-
-	Handle<Object> returnObject = Object::New(isolate);
-	returnObject->Set(
-		String::NewFromUtf8(isolate,"in"),
-		in_object
-	);
-	returnObject->Set(
-		String::NewFromUtf8(isolate,"out"),
-		out_array
-	);
+		in_object->Set(context, NewString(isolate, existing.at(i).c_str()),
+			NewString(isolate, transcriptions.at(i).c_str())).Check();
+	}
+
+	Local<Object> returnObject = Object::New(isolate);
+	returnObject->Set(context, NewString(isolate,"in"),
+		in_object).Check();
+	returnObject->Set(context, NewString(isolate,"out"),
+		out_array).Check();
 
     // Add the array to the return value
     args.GetReturnValue().Set(returnObject);
 }
 
 void Recognizer::AddWords(const FunctionCallbackInfo<Value>& args) {
-	Isolate* isolate = Isolate::GetCurrent();
+	Isolate* isolate = args.GetIsolate();
 	HandleScope scope(isolate);
+	Local<Context> context = isolate->GetCurrentContext();
 	Recognizer* instance = node::ObjectWrap::Unwrap<Recognizer>(args.Holder());
 
+	if(!Ready(instance, isolate)) {
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
 	if(args.Length() < 1) {
-		//isolate->ThrowException(Exception::TypeError(String::NewFromUtf8(isolate, "Incorrect number of arguments, expected options at least")));
-		Recognizer::TypeError(instance, isolate, String::NewFromUtf8(isolate, "Incorrect number of arguments, expected words"));
+		//isolate->ThrowException(Exception::TypeError(NewString(isolate, "Incorrect number of arguments, expected options at least")));
+		Recognizer::TypeError(instance, isolate, "Incorrect number of arguments, expected words");
 		args.GetReturnValue().Set(Undefined(isolate));
 		return;
 	}
 
 	if(!args[0]->IsObject()) {
-		//isolate->ThrowException(Exception::TypeError(String::NewFromUtf8(isolate, "Expected options to be an object")));
-		Recognizer::TypeError(instance, isolate, String::NewFromUtf8(isolate, "Expected words to be an object"));
+		//isolate->ThrowException(Exception::TypeError(NewString(isolate, "Expected options to be an object")));
+		Recognizer::TypeError(instance, isolate, "Expected words to be an object");
 		args.GetReturnValue().Set(Undefined(isolate));
 		return;
 	}
 
-	Handle<Object> words = Handle<Object>::Cast(args[0]);
-	Local<Array> property_names = words->GetOwnPropertyNames();
+	Local<Object> words = Local<Object>::Cast(args[0]);
+	Local<Array> property_names = words->GetOwnPropertyNames(context).ToLocalChecked();
+	vector<pair<string, string> > added;
 
 	for (unsigned int i = 0; i < property_names->Length(); ++i) {
-		Local<Value> key = property_names->Get(i);
-		Local<Value> value = words->Get(key);
+		Local<Value> key = property_names->Get(context, i).ToLocalChecked();
+		Local<Value> value = words->Get(context, key).ToLocalChecked();
 
 		if (key->IsString() && value->IsString()) {
-			String::Utf8Value utf8_key(key);
-			String::Utf8Value utf8_value(value);
+			String::Utf8Value utf8_key(isolate, key);
+			String::Utf8Value utf8_value(isolate, value);
 			//cout << *utf8_key << "->" << *utf8_value << endl;
 			int update = i == property_names->Length()-1 ? 1 : 0;
-			ps_add_word(instance->ps, *utf8_key, *utf8_value, update);
+			if(ps_add_word(instance->ps, *utf8_key, *utf8_value, update) >= 0) {
+				added.push_back(make_pair(string(*utf8_key), string(*utf8_value)));
+				instance->addedWords.push_back(added.back());
+				// Decoders of decodeChannels and align know the word as well
+				for(size_t j = 0; j < instance->channelDecoders.size(); j++) {
+					ps_add_word(instance->channelDecoders[j], *utf8_key, *utf8_value, update);
+				}
+			}
 		}
 	}
+	instance->recorder.Words(added);
 }
 
-void Recognizer::AsyncWorker(uv_work_t* request) {
-	Isolate* isolate = Isolate::GetCurrent();
-	AsyncData* data = reinterpret_cast<AsyncData*>(request->data);
+KeywordList* Recognizer::ActiveKeywords(Recognizer* instance) {
+	map<string, KeywordList>::iterator it = instance->keywordLists.find(ActiveSearch(instance));
+	return it != instance->keywordLists.end() ? &it->second : NULL;
+}
 
-	if(ps_process_raw(data->instance->ps, data->data, data->length, FALSE, FALSE)) {
-		data->hasException = TRUE;
-		data->exception = Exception::Error(String::NewFromUtf8(isolate, "Failed to process audio data"));
-		return;
+bool Recognizer::ApplyKeywords(Recognizer* instance, Isolate* isolate, const char* name) {
+	KeywordList& list = instance->keywordLists[name];
+	if(!list.Dirty())
+		return true;
+
+	// Searches can't be replaced while decoding, the edits wait for the next utterance
+	if(instance->processing)
+		return true;
+
+	const char* error = list.Apply(instance->ps, name);
+	if(error != NULL) {
+		Recognizer::Error(instance, isolate, error);
+		return false;
+	}
+	instance->recorder.Keywords(name, list.Thresholds());
+	return true;
+}
+
+bool Recognizer::KeywordPhrase(Recognizer* instance, Isolate* isolate, const char* phrase, double threshold, string* words) {
+	if(!KeywordList::Normalize(phrase, words)) {
+		Recognizer::TypeError(instance, isolate, "Expected phrase to be words without '/' or line breaks");
+		return false;
+	}
+	// The keyword file takes the logarithm, NaN, infinite or non positive thresholds can't be written to it
+	if(!(threshold > 0) || threshold > DBL_MAX) {
+		Recognizer::TypeError(instance, isolate, "Expected threshold to be a positive number");
+		return false;
 	}
+	return true;
+}
 
-	int32 score;
-	const char* hyp = ps_get_hyp(data->instance->ps, &score);
+void Recognizer::EmitKeywords(Recognizer* instance, Isolate* isolate, const vector<KeywordDetection>& keywords) {
+	if(!Listening(instance, instance->keywordCallback))
+		return;
 
-	data->score = score;
-	data->hyp = hyp;
+	for(size_t i = 0; i < keywords.size(); i++) {
+		EventArg argv[5];
+		argv[0].SetNull();
+		argv[1].SetString(keywords[i].phrase.c_str());
+		argv[2].SetNumber(keywords[i].start);
+		argv[3].SetNumber(keywords[i].end);
+		argv[4].SetNumber(keywords[i].score);
+		Emit(instance, isolate, "keyword", instance->keywordCallback, 5, argv);
+
+		// A handler may have freed the Recognizer
+		if(instance->destructed)
+			return;
+	}
 }
 
-void Recognizer::AsyncAfter(uv_work_t* request) {
-	Isolate* isolate = Isolate::GetCurrent();
-	AsyncData* data = reinterpret_cast<AsyncData*>(request->data);
+double Recognizer::AudioDuration(Recognizer* instance, size_t samples) {
+	return samples / cmd_ln_float_r(DecoderConfig(instance), "-samprate");
+}
 
+void Recognizer::CollectSegments(ps_decoder_t* ps, vector<Segment>& segments) {
+	logmath_t* lmath = ps_get_logmath(ps);
+	for(ps_seg_t* seg = ps_seg_iter(ps); seg != NULL; seg = ps_seg_next(seg)) {
+		Segment segment;
+		int32 ascr, lscr, lback;
+		segment.word.assign(ps_seg_word(seg));
+		ps_seg_frames(seg, &segment.start, &segment.end);
+		segment.prob = logmath_exp(lmath, ps_seg_prob(seg, &ascr, &lscr, &lback));
+		segments.push_back(segment);
+	}
+}
 
-	if(data->hasException) {
-		Handle<Value> argv[1] = { data->exception };
-		if(!data->instance->hypCallback.IsEmpty()) {
-			Local<Function> cb = Local<Function>::New(isolate, data->instance->hypCallback);
-			cb->Call(isolate->GetCurrentContext()->Global(), 1, argv);
-		}
-	} else {
-		Handle<Value> argv[3] = { Null(isolate), data->hyp ? String::NewFromUtf8(isolate,data->hyp) : String::NewFromUtf8(isolate, ""), NumberObject::New(isolate,data->score)};
-		if(!data->instance->hypCallback.IsEmpty()) {
-			Local<Function> cb = Local<Function>::New(isolate, data->instance->hypCallback);
-			cb->Call(isolate->GetCurrentContext()->Global(), 3, argv);
-		}
+Local<Array> Recognizer::SegmentArray(Isolate* isolate, const vector<Segment>& segments) {
+	Local<Context> context = isolate->GetCurrentContext();
+	Local<Array> array = Array::New(isolate, int(segments.size()));
+	for(size_t i = 0; i < segments.size(); i++) {
+		Local<Object> segment = Object::New(isolate);
+		segment->Set(context, NewString(isolate, "word"), NewString(isolate, segments[i].word.c_str())).Check();
+		segment->Set(context, NewString(isolate, "start"), Integer::New(isolate, segments[i].start)).Check();
+		segment->Set(context, NewString(isolate, "end"), Integer::New(isolate, segments[i].end)).Check();
+		segment->Set(context, NewString(isolate, "prob"), Number::New(isolate, segments[i].prob)).Check();
+		array->Set(context, i, segment).Check();
 	}
+	return array;
 }
 
 Local<Value> Recognizer::Default(Local<Value> value, Local<Value> fallback) {
@@ -813,58 +1344,49 @@ Local<Value> Recognizer::Default(Local<Value> value, Local<Value> fallback) {
 	return value;
 }
 
-cmd_ln_t* Recognizer::BuildConfig(Handle<Object> options) {
-
-	Isolate* isolate = Isolate::GetCurrent();
+cmd_ln_t* Recognizer::BuildConfig(AddonData* addon, Isolate* isolate, Local<Object> options) {
+	Local<Context> context = isolate->GetCurrentContext();
 
 	// Create an empty command line config
 	cmd_ln_t* config = cmd_ln_init(NULL, ps_args(), TRUE, NULL);
 
 	// Add default parameters if they do not exist
-	options->Set(
-		String::NewFromUtf8(isolate,"-hmm"),
-		Default(options->Get(String::NewFromUtf8(isolate,"-hmm")), String::NewFromUtf8(isolate, MODELDIR "/en-us/en-us"))
-	);
-	options->Set(
-		String::NewFromUtf8(isolate,"-dict"),
-		Default(options->Get(String::NewFromUtf8(isolate,"-dict")), String::NewFromUtf8(isolate, MODELDIR "/en-us/cmudict-en-us.dict"))
-	);
+	options->Set(context, NewString(isolate,"-hmm"),
+		Default(options->Get(context, NewString(isolate,"-hmm")).ToLocalChecked(), NewString(isolate, MODELDIR "/en-us/en-us"))).Check();
+	options->Set(context, NewString(isolate,"-dict"),
+		Default(options->Get(context, NewString(isolate,"-dict")).ToLocalChecked(), NewString(isolate, MODELDIR "/en-us/cmudict-en-us.dict"))).Check();
 	// For some reason when passing -samprate or -agcthresh (maybe more) the values will be set wrong and some weird values are added
-	options->Set(
-		String::NewFromUtf8(isolate,"-samprate"),
-		Default(options->Get(String::NewFromUtf8(isolate,"-samprate")), Number::New(isolate, 44100))
-	);
-	options->Set(
-		String::NewFromUtf8(isolate,"-nfft"),
-		Default(options->Get(String::NewFromUtf8(isolate,"-nfft")), Number::New(isolate, 2048))
-	);
+	options->Set(context, NewString(isolate,"-samprate"),
+		Default(options->Get(context, NewString(isolate,"-samprate")).ToLocalChecked(), Number::New(isolate, 44100))).Check();
+	options->Set(context, NewString(isolate,"-nfft"),
+		Default(options->Get(context, NewString(isolate,"-nfft")).ToLocalChecked(), Number::New(isolate, 2048))).Check();
 
 	// Add all parameters to the config
-	Local<Array> propertyNames = options->GetOwnPropertyNames();
+	Local<Array> propertyNames = options->GetOwnPropertyNames(context).ToLocalChecked();
 	for (uint32_t i = 0; i < propertyNames->Length(); ++i)
 	{
-		Local<Value> key = propertyNames->Get(i);
-		Local<Value> val = options->Get(key);
+		Local<Value> key = propertyNames->Get(context, i).ToLocalChecked();
+		Local<Value> val = options->Get(context, key).ToLocalChecked();
 
 		if (key->IsString()) {
 
-			String::Utf8Value utf8_key(key);
+			String::Utf8Value utf8_key(isolate, key);
 			// Check if the key is valid
 			anytype_t *ps_val;
 			ps_val = cmd_ln_access_r(config, *utf8_key);
 			if (ps_val == NULL) {
-				Local<String> err = String::Concat(String::NewFromUtf8(isolate, "Unknown pocketsphinx argument: "), String::NewFromUtf8(isolate, *utf8_key));
+				Local<String> err = String::Concat(isolate, NewString(isolate, "Unknown pocketsphinx argument: "), NewString(isolate, *utf8_key));
 				isolate->ThrowException(Exception::TypeError(err));
 			}
 
 			// Add String values
 			if (val->IsString()) {
-				String::Utf8Value utf8_val(val);
+				String::Utf8Value utf8_val(isolate, val);
 				cmd_ln_set_str_r(config, *utf8_key, *utf8_val);
 
 			// Add numeric values
 			} else if(val->IsNumber()) {
-				double num_val = double(val->NumberValue());
+				double num_val = double(val->NumberValue(context).FromJust());
 				// Check if the number is a float or int
 				bool isInt = (val->IsInt32() || val->IsUint32());
 				// Also some numbers have to be passed as float, otherwise ps configuration will crash
@@ -884,66 +1406,196 @@ cmd_ln_t* Recognizer::BuildConfig(Handle<Object> options) {
 
 			// Add boolean values
 			} else if(val->IsBoolean()) {
-				bool bool_val = bool(val->BooleanValue());
+				bool bool_val = bool(val->BooleanValue(isolate));
 				cmd_ln_set_boolean_r(config, *utf8_key, bool_val);
 
 			// Some other unknown value type was found
 			} else {
-				Local<String> err = String::Concat(String::NewFromUtf8(isolate, "Unknown value type for key: "), String::NewFromUtf8(isolate, *utf8_key));
+				Local<String> err = String::Concat(isolate, NewString(isolate, "Unknown value type for key: "), NewString(isolate, *utf8_key));
 				isolate->ThrowException(Exception::TypeError(err));
 			}
 		} else {
-			isolate->ThrowException(Exception::TypeError(String::NewFromUtf8(isolate, "All argument keys must be strings")));
+			isolate->ThrowException(Exception::TypeError(NewString(isolate, "All argument keys must be strings")));
+		}
+	}
+
+	// Swap text language models for their cached binary version. The acoustic model is mapped
+	// read only so processes share its pages, unless the caller decided about -mmap
+	if(ModelCache::Enabled()) {
+		const char* lm = cmd_ln_str_r(config, "-lm");
+		if(lm != NULL) {
+			string path = CachedNgram(addon, lm);
+			cmd_ln_set_str_r(config, "-lm", path.c_str());
 		}
+		if(!options->HasOwnProperty(context, NewString(isolate, "-mmap")).FromJust())
+			cmd_ln_set_boolean_r(config, "-mmap", TRUE);
 	}
 
 	return config;
 }
 
-void Recognizer::Error(Recognizer* instance, Isolate* isolate, const Handle<v8::String> msg) {
-	if(!instance->errorCallback.IsEmpty()) {
-		Handle<Value> argv[1] = { Exception::Error(msg) };
-		Local<Function> cb = Local<Function>::New(isolate, instance->errorCallback);
-		cb->Call(isolate->GetCurrentContext()->Global(), 1, argv);
-	}
+bool Recognizer::Listening(Recognizer* instance, Persistent<Function>& callback) {
+	return instance->addon->eventSink.Enabled() || !callback.IsEmpty();
 }
-void Recognizer::TypeError(Recognizer* instance, Isolate* isolate, const Handle<v8::String> msg) {
-	if(!instance->errorCallback.IsEmpty()) {
-		Handle<Value> argv[1] = { Exception::TypeError(msg) };
-		Local<Function> cb = Local<Function>::New(isolate, instance->errorCallback);
-		cb->Call(isolate->GetCurrentContext()->Global(), 1, argv);
+
+void Recognizer::Emit(Recognizer* instance, Isolate* isolate, const char* event, Persistent<Function>& callback, int argc, const EventArg* argv) {
+	// Queue for the module level sink, it gets all events of this tick at once
+	if(instance->addon->eventSink.Enabled()) {
+		instance->addon->eventSink.Push(instance, event, argc, argv);
+		return;
+	}
+
+	if(callback.IsEmpty())
+		return;
+
+	// Converted like the sink does, so a handler gets the same types either way
+	Local<Value> values[EVENT_MAX_ARGS];
+	for(int i = 0; i < argc; i++) {
+		values[i] = argv[i].ToValue(isolate);
 	}
+
+	TraceSpan span("js", event, instance->traceId, instance->traceChunk);
+	Local<Function> cb = Local<Function>::New(isolate, callback);
+	CallFunction(isolate, cb, argc, values);
+}
+
+void Recognizer::Error(Recognizer* instance, Isolate* isolate, const char* message) {
+	EventArg argv[1];
+	argv[0].SetError(message);
+	Emit(instance, isolate, "error", instance->errorCallback, 1, argv);
+}
+void Recognizer::TypeError(Recognizer* instance, Isolate* isolate, const char* message) {
+	EventArg argv[1];
+	argv[0].SetTypeError(message);
+	Emit(instance, isolate, "error", instance->errorCallback, 1, argv);
 }
 
 void Recognizer::FromFloat(const FunctionCallbackInfo<Value>& args) {
-	Isolate* isolate = Isolate::GetCurrent();
+	Isolate* isolate = args.GetIsolate();
 	HandleScope scope(isolate);
 
 	if(!args.Length()) {
-		isolate->ThrowException(Exception::TypeError(String::NewFromUtf8(isolate,"Expected a data buffer to be provided")));
-		args.GetReturnValue().Set(args.Holder());
+		isolate->ThrowException(Exception::TypeError(NewString(isolate,"Expected a data buffer to be provided")));
+		return;
 	}
 
 	if(!node::Buffer::HasInstance(args[0])) {
-		isolate->ThrowException(Exception::Error(String::NewFromUtf8(isolate,"Expected data to be a buffer")));
-		args.GetReturnValue().Set(args.Holder());
+		isolate->ThrowException(Exception::Error(NewString(isolate,"Expected data to be a buffer")));
+		return;
 	}
 
 	float* data = reinterpret_cast<float*>(node::Buffer::Data(args[0]));
 	size_t length = node::Buffer::Length(args[0]) / sizeof(float);
 
-	Local<Object> slowBuffer = node::Buffer::New(isolate, length * sizeof(int16)).ToLocalChecked();
-	int16* slowBufferData = reinterpret_cast<int16*>(node::Buffer::Data(slowBuffer));
-
-	//args.GetReturnValue().Set(args.Holder());
+	// node::Buffer::New returns a regular Buffer, no need to wrap it in JavaScript anymore
+	Local<Object> buffer = node::Buffer::New(isolate, length * sizeof(int16)).ToLocalChecked();
+	int16* bufferData = reinterpret_cast<int16*>(node::Buffer::Data(buffer));
 
 	for(size_t i = 0; i < length; i++)
-		slowBufferData[i] = data[i] * 32768;
-
-	// Courtesy of http://sambro.is-super-awesome.com/2011/03/03/creating-a-proper-buffer-in-a-node-c-addon/
-	Local<Object> globalObj = isolate->GetCurrentContext()->Global();
-	Local<Function> bufferConstructor = Local<Function>::Cast(globalObj->Get(String::NewFromUtf8(isolate, "Buffer")));
-	Handle<Value> constructorArgs[3] = { slowBuffer, Integer::New(isolate, length), Integer::New(isolate, 0) };
-	Local<Object> actualBuffer = bufferConstructor->NewInstance(3, constructorArgs);
-	args.GetReturnValue().Set(actualBuffer);
-}
\ No newline at end of file
+		bufferData[i] = data[i] * 32768;
+
+	args.GetReturnValue().Set(buffer);
+}
+
+void Recognizer::JobPoolStats(const FunctionCallbackInfo<Value>& args) {
+	Isolate* isolate = args.GetIsolate();
+	HandleScope scope(isolate);
+	Local<Context> context = isolate->GetCurrentContext();
+	JobPool& jobPool = AddonData::From(args.Data())->jobPool;
+
+	if(args.Length() >= 1) {
+		if(!args[0]->IsUint32()) {
+			isolate->ThrowException(Exception::TypeError(NewString(isolate, "Expected capacity to be a positive integer")));
+			return;
+		}
+		jobPool.SetCapacity(args[0]->Uint32Value(context).FromJust());
+	}
+
+	if(args.Length() >= 2) {
+		if(!args[1]->IsUint32() || args[1]->Uint32Value(context).FromJust() == 0) {
+			isolate->ThrowException(Exception::TypeError(NewString(isolate, "Expected limit to be a positive integer")));
+			return;
+		}
+		jobPool.SetLimit(args[1]->Uint32Value(context).FromJust());
+	}
+
+	Local<Object> stats = Object::New(isolate);
+	stats->Set(context, NewString(isolate, "capacity"), Number::New(isolate, double(jobPool.Capacity()))).Check();
+	stats->Set(context, NewString(isolate, "pooled"), Number::New(isolate, double(jobPool.Pooled()))).Check();
+	stats->Set(context, NewString(isolate, "active"), Number::New(isolate, double(jobPool.Active()))).Check();
+	stats->Set(context, NewString(isolate, "limit"), Number::New(isolate, double(jobPool.Limit()))).Check();
+
+	args.GetReturnValue().Set(stats);
+}
+
+void Recognizer::SetEventSink(const FunctionCallbackInfo<Value>& args) {
+	Isolate* isolate = args.GetIsolate();
+	HandleScope scope(isolate);
+	AddonData* addon = AddonData::From(args.Data());
+
+	if(args.Length() < 1) {
+		isolate->ThrowException(Exception::TypeError(NewString(isolate, "Incorrect number of arguments, expected sink")));
+		return;
+	}
+
+	if(args[0]->IsNull() || args[0]->IsUndefined()) {
+		addon->eventSink.Clear(isolate);
+		return;
+	}
+
+	if(!args[0]->IsFunction()) {
+		isolate->ThrowException(Exception::TypeError(NewString(isolate, "Expected sink to be a function or null")));
+		return;
+	}
+
+	addon->eventSink.SetCallback(isolate, addon->loop, Local<Function>::Cast(args[0]));
+}
+
+void Recognizer::GovernorStats(const FunctionCallbackInfo<Value>& args) {
+	Isolate* isolate = args.GetIsolate();
+	HandleScope scope(isolate);
+	Local<Context> context = isolate->GetCurrentContext();
+
+	if(args.Length() >= 1) {
+		if(args[0]->IsBoolean() && !args[0]->BooleanValue(isolate)) {
+			Governor::Configure(false, 0, 0);
+		} else if(args[0]->IsObject()) {
+			Local<Object> options = args[0].As<Object>();
+			Local<Value> maxBacklog = options->Get(context, NewString(isolate, "maxBacklog")).ToLocalChecked();
+			Local<Value> protectedPriority = Default(options->Get(context, NewString(isolate, "protectedPriority")).ToLocalChecked(), Integer::New(isolate, 1));
+			if(!maxBacklog->IsNumber() || !protectedPriority->IsInt32()) {
+				isolate->ThrowException(Exception::TypeError(NewString(isolate, "Expected maxBacklog to be milliseconds and protectedPriority to be an integer")));
+				return;
+			}
+			Governor::Configure(true, maxBacklog->NumberValue(context).FromJust(), protectedPriority->Int32Value(context).FromJust());
+		} else {
+			isolate->ThrowException(Exception::TypeError(NewString(isolate, "Expected options to be an object or false")));
+			return;
+		}
+	}
+
+	struct GovernorStats state = Governor::Stats();
+	Local<Object> stats = Object::New(isolate);
+	stats->Set(context, NewString(isolate, "enabled"), Boolean::New(isolate, state.enabled)).Check();
+	stats->Set(context, NewString(isolate, "backlog"), Number::New(isolate, state.backlog)).Check();
+	stats->Set(context, NewString(isolate, "maxBacklog"), Number::New(isolate, state.maxBacklog)).Check();
+	stats->Set(context, NewString(isolate, "protectedPriority"), Integer::New(isolate, state.protectedPriority)).Check();
+	stats->Set(context, NewString(isolate, "streams"), Number::New(isolate, double(state.streams))).Check();
+	stats->Set(context, NewString(isolate, "refused"), Number::New(isolate, double(state.refused))).Check();
+	stats->Set(context, NewString(isolate, "dropped"), Number::New(isolate, double(state.dropped))).Check();
+	stats->Set(context, NewString(isolate, "late"), Number::New(isolate, double(state.late))).Check();
+
+	args.GetReturnValue().Set(stats);
+}
+
+void Recognizer::MemoryStats(const FunctionCallbackInfo<Value>& args) {
+	Isolate* isolate = args.GetIsolate();
+	HandleScope scope(isolate);
+	Local<Context> context = isolate->GetCurrentContext();
+
+	Local<Object> stats = Object::New(isolate);
+	stats->Set(context, NewString(isolate, "decoders"), Number::New(isolate, double(MemoryTracker::Decoders()))).Check();
+	stats->Set(context, NewString(isolate, "bytes"), Number::New(isolate, double(MemoryTracker::Bytes()))).Check();
+
+	args.GetReturnValue().Set(stats);
+}
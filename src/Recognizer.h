@@ -8,14 +8,35 @@
 #include <node_object_wrap.h>
 #include <pocketsphinx.h>
 #include <sphinxbase/err.h>
+#include <sphinxbase/ckd_alloc.h>
 #include <sphinxbase/jsgf.h>
 
+#include "AddonData.h"
+#include "EndpointDetector.h"
+#include "Governor.h"
+#include "JobPool.h"
+#include "KeywordList.h"
+#include "MemoryTracker.h"
+#include "ModelCache.h"
+#include "PruningController.h"
+#include "Rescorer.h"
+#include "SessionLog.h"
+#include "SharedModels.h"
+#include "Tracer.h"
+#include "Util.h"
+
+#include <map>
+#include <string>
 #include <vector>
 
 class Recognizer : public node::ObjectWrap
 {
+	friend class AddonData;
+	friend class EventSink;
+	friend class DecoderQueue;
+
 public:
-	static void Init(v8::Handle<v8::Object> exports);
+	static void Init(v8::Local<v8::Object> exports, v8::Local<v8::Context> context);
 
 private:
 	explicit Recognizer();
@@ -26,6 +47,13 @@ private:
 	static void Reconfig(const v8::FunctionCallbackInfo<v8::Value>&);
 
 	static void SilenceDetection(const v8::FunctionCallbackInfo<v8::Value>&);
+	static void Endpointer(const v8::FunctionCallbackInfo<v8::Value>&);
+	static void Pipeline(const v8::FunctionCallbackInfo<v8::Value>&);
+	static void AdaptivePruning(const v8::FunctionCallbackInfo<v8::Value>&);
+	static void PruningStats(const v8::FunctionCallbackInfo<v8::Value>&);
+	static void Hibernate(const v8::FunctionCallbackInfo<v8::Value>&);
+	static void HibernationStats(const v8::FunctionCallbackInfo<v8::Value>&);
+	static void Qos(const v8::FunctionCallbackInfo<v8::Value>&);
 
 	static void On(const v8::FunctionCallbackInfo<v8::Value>&);
 	static void Off(const v8::FunctionCallbackInfo<v8::Value>&);
@@ -36,6 +64,12 @@ private:
 
 	static void Write(const v8::FunctionCallbackInfo<v8::Value>&);
 	static void WriteSync(const v8::FunctionCallbackInfo<v8::Value>&);
+	static void DecodeFile(const v8::FunctionCallbackInfo<v8::Value>&);
+	static void Record(const v8::FunctionCallbackInfo<v8::Value>&);
+	static void Replay(const v8::FunctionCallbackInfo<v8::Value>&);
+	static void DecodeChannels(const v8::FunctionCallbackInfo<v8::Value>&);
+	static void Confidence(const v8::FunctionCallbackInfo<v8::Value>&);
+	static void Align(const v8::FunctionCallbackInfo<v8::Value>&);
 
 	static void LookupWords(const v8::FunctionCallbackInfo<v8::Value>&);
 	static void AddWords(const v8::FunctionCallbackInfo<v8::Value>&);
@@ -45,21 +79,112 @@ private:
 	static void AddGrammarSearch(const v8::FunctionCallbackInfo<v8::Value>&);
 	static void AddNgramSearch(const v8::FunctionCallbackInfo<v8::Value>&);
 
+	static void SetKeywords(const v8::FunctionCallbackInfo<v8::Value>&);
+	static void AddKeyword(const v8::FunctionCallbackInfo<v8::Value>&);
+	static void RemoveKeyword(const v8::FunctionCallbackInfo<v8::Value>&);
+
 	static void GetSearch(v8::Local<v8::String>, const v8::PropertyCallbackInfo<v8::Value>&);
 	static void SetSearch(v8::Local<v8::String>, v8::Local<v8::Value>, const v8::PropertyCallbackInfo<void>&);
 
 	static void FromFloat(const v8::FunctionCallbackInfo<v8::Value>&);
+	static void JobPoolStats(const v8::FunctionCallbackInfo<v8::Value>&);
+	static void SetEventSink(const v8::FunctionCallbackInfo<v8::Value>&);
+	static void ModelCacheStats(const v8::FunctionCallbackInfo<v8::Value>&);
+	static void PrepareModel(const v8::FunctionCallbackInfo<v8::Value>&);
+	static void GovernorStats(const v8::FunctionCallbackInfo<v8::Value>&);
+	static void Trace(const v8::FunctionCallbackInfo<v8::Value>&);
+	static void MemoryStats(const v8::FunctionCallbackInfo<v8::Value>&);
+
+	static void StartUtterance(Recognizer* instance, v8::Isolate* isolate);
+	static void StopUtterance(Recognizer* instance, v8::Isolate* isolate);
+	static void RestartUtterance(Recognizer* instance, v8::Isolate* isolate);
+	static void QueueControl(Recognizer* instance, v8::Isolate* isolate, int type);
+	static void ControlAfter(DecoderJob* job);
+	static void QueueWrite(Recognizer* instance, v8::Isolate* isolate, v8::Local<v8::Object> buffer);
+	static void AsyncWorker(DecoderJob* job);
+	static void AsyncAfter(DecoderJob* job);
+	static void DecodeFileWorker(uv_work_t* request);
+	static const char* EndFileUtterance(ps_decoder_t* ps, struct DecodeFileData* data);
+	static void DecodeFileAfter(uv_work_t* request);
+	static void ReplayWorker(DecoderJob* job);
+	static void ReplayAfter(DecoderJob* job);
+	static void FinishReplay(struct ReplayData* data);
+	static void ReplayUtteranceEnded(Recognizer* instance);
+	static void ApplyPruning(Recognizer* instance);
+	static void ChannelsPrepareWorker(uv_work_t* request);
+	static void ChannelsPrepareAfter(uv_work_t* request);
+	static void QueueChannels(struct MultiChannelData* data);
+	static void ChannelWorker(uv_work_t* request);
+	static void ChannelAfter(uv_work_t* request);
+	static void FinishChannels(struct MultiChannelData* data);
+	static void FreeChannels(Recognizer* instance);
+	static void FreeDecoder(Recognizer* instance);
+	static void UpdateMemory(Recognizer* instance);
+	static void RememberSearch(Recognizer* instance, int type, const char* name, const char* argument);
+	static void ForgetDecoderState(Recognizer* instance);
+	static void InvalidateKeywords(Recognizer* instance);
+	static void Touch(Recognizer* instance);
+	static void IdleTimeout(uv_timer_t* handle);
+	static void CloseTimer(uv_handle_t* handle);
+	static void ReleaseTimer(uv_handle_t* handle);
+	static void Teardown(Recognizer* instance);
+	static void Sleep(Recognizer* instance);
+	// Every call that touches the decoder asks first. Refuses after free() and while other work owns the
+	// decoder, and rebuilds it when it hibernated; queued calls restore it on a pool thread instead and
+	// may wait behind written chunks
+	static bool Ready(Recognizer* instance, v8::Isolate* isolate, bool queued = false);
+	static bool Wake(Recognizer* instance, v8::Isolate* isolate);
+	static void QueueRestore(Recognizer* instance);
+	static struct RestoreData* PrepareRestore(Recognizer* instance);
+	static void BuildDecoder(struct RestoreData* data, AddonData* addon);
+	static void RestoreWorker(DecoderJob* job);
+	static void RestoreAfter(DecoderJob* job);
+	static bool Restored(Recognizer* instance, v8::Isolate* isolate, struct RestoreData* data);
+	static cmd_ln_t* CopyConfig(cmd_ln_t* config);
+	// Answer from the remembered state while the decoder is hibernated or being restored
+	static cmd_ln_t* DecoderConfig(Recognizer* instance);
+	static const char* ActiveSearch(Recognizer* instance);
+	static const char* EnsureDecoders(Recognizer* instance, size_t count);
+	static int AddSearch(ps_decoder_t* ps, const struct SearchDefinition& search);
+	static void AlignPrepareWorker(uv_work_t* request);
+	static void AlignPrepareAfter(uv_work_t* request);
+	static void AlignWorker(uv_work_t* request);
+	static void AlignAfter(uv_work_t* request);
+	static void FinishAlign(struct AlignBatch* batch);
+	static v8::Local<v8::Int32Array> FrameArray(v8::Isolate* isolate, const std::vector<int32>& frames);
+	static const char* AlignItem(ps_decoder_t* ps, struct AlignJob& job, bool silence);
+	static void ConfidenceWorker(uv_work_t* request);
+	static void ConfidenceAfter(uv_work_t* request);
+	static void QueueRescore(Recognizer* instance);
+	static void RescoreWorker(uv_work_t* request);
+	static void RescoreAfter(uv_work_t* request);
+	static std::string CachedNgram(AddonData* addon, const char* path);
+	static void ConvertModel(AddonData* addon, v8::Isolate* isolate, const char* path, v8::Local<v8::Function> callback);
+	static void ConvertModelWorker(uv_work_t* request);
+	static void ConvertModelAfter(uv_work_t* request);
+
+	static void DecodeChunk(Recognizer* instance, AsyncData* data);
+	static void DeliverChunk(Recognizer* instance, v8::Isolate* isolate, AsyncData* data);
 
-	static v8::Persistent<v8::Function> constructor;
-	static void AsyncWorker(uv_work_t* request);
-	static void AsyncAfter(uv_work_t* request);
+	static KeywordList* ActiveKeywords(Recognizer* instance);
+	static bool ApplyKeywords(Recognizer* instance, v8::Isolate* isolate, const char* name);
+	static bool KeywordPhrase(Recognizer* instance, v8::Isolate* isolate, const char* phrase, double threshold, std::string* words);
+	static void EmitKeywords(Recognizer* instance, v8::Isolate* isolate, const std::vector<KeywordDetection>& keywords);
+
+	static double AudioDuration(Recognizer* instance, size_t samples);
+	static void CollectSegments(ps_decoder_t* ps, std::vector<struct Segment>& segments);
+	static v8::Local<v8::Array> SegmentArray(v8::Isolate* isolate, const std::vector<struct Segment>& segments);
 
 	static v8::Local<v8::Value> Default(v8::Local<v8::Value> value, v8::Local<v8::Value> fallback);
-	static cmd_ln_t* BuildConfig(v8::Handle<v8::Object> options);
+	static cmd_ln_t* BuildConfig(AddonData* addon, v8::Isolate* isolate, v8::Local<v8::Object> options);
+
+	static bool Listening(Recognizer* instance, v8::Persistent<v8::Function>& callback);
+	static void Emit(Recognizer* instance, v8::Isolate* isolate, const char* event, v8::Persistent<v8::Function>& callback, int argc, const EventArg* argv);
 
-	static void Error(Recognizer* instance, v8::Isolate* isolate, const v8::Handle<v8::String> msg);
-	static void TypeError(Recognizer* instance, v8::Isolate* isolate, const v8::Handle<v8::String> msg);
+	static void Error(Recognizer* instance, v8::Isolate* isolate, const char* message);
+	static void TypeError(Recognizer* instance, v8::Isolate* isolate, const char* message);
 
+	AddonData* addon;
 	ps_decoder_t* ps;
 
 	v8::Persistent<v8::Function> hypCallback;
@@ -69,25 +194,269 @@ private:
 	v8::Persistent<v8::Function> speechDetectedCallback;
 	v8::Persistent<v8::Function> silenceDetectedCallback;
 	v8::Persistent<v8::Function> errorCallback;
+	v8::Persistent<v8::Function> endpointCallback;
+	v8::Persistent<v8::Function> hypRescoredCallback;
+	v8::Persistent<v8::Function> keywordCallback;
+	v8::Persistent<v8::Function> droppedCallback;
+	v8::Persistent<v8::Function> lateCallback;
+	v8::Persistent<v8::Function> hibernatedCallback;
+	v8::Persistent<v8::Function> restoredCallback;
 
 	bool destructed;
 	bool processing;
+	// Set while a native job like decodeFile owns the decoder
+	bool busy;
+	// The session replayed into the Recognizer, it collects the final hypotheses
+	struct ReplayData* replaying;
+	// Writes and the start(), stop() and restart() calls behind them, one at a time
+	DecoderQueue queue;
 
 	// Silence detection
 	bool silenceDetection;
 	bool speechDetected;
 
+	// Endpointing on the frames of the utterance
+	EndpointDetector endpoint;
+
+	// Second pass, lattices of finished utterances are rescored with a large shared model
+	SharedNgram* rescoreLm;
+	float32 rescoreLw;
+
+	// Keyword searches managed in memory by name, and the end frame of the last reported detection
+	std::map<std::string, KeywordList> keywordLists;
+	int32 lastKeywordFrame;
+
+	// Adapts the beams between utterances to hold a real time factor
+	PruningController pruning;
+
+	// Priority, deadline and queued audio as seen by the process wide governor
+	GovernorStream qos;
+
+	// Identifies the spans of this Recognizer in traces
+	uint32_t traceId;
+	// Last chunk number handed out, and the chunk whose events are emitted right now (0 for none)
+	uint32_t traceChunks;
+	uint32_t traceChunk;
+
+	// Chunks and control calls are appended here while record() is active
+	SessionRecorder recorder;
+
+	// Decoders next to ps for decodeChannels and align, created on first use
+	std::vector<ps_decoder_t*> channelDecoders;
+	// Bumped when the searches added at runtime change, and the version the channel decoders have
+	uint32_t searchVersion;
+	uint32_t channelVersion;
+
+	// Native memory and decoders of this Recognizer as last reported to V8 and the MemoryTracker
+	int64_t externalMemory;
+	int trackedDecoders;
+
+	// Searches and words added at runtime, kept compact so a hibernated decoder can be rebuilt
+	std::vector<struct SearchDefinition> searches;
+	std::vector<std::pair<std::string, std::string> > addedWords;
+
+	// Hibernation frees the decoder after idleMs without use, the next call rebuilds it from here
+	uv_timer_t* idleTimer;
+	uint64_t idleMs;
+	bool hibernated;
+	// A restore job is queued, the decoder stays hibernated until it is installed
+	bool restoring;
+	cmd_ln_t* hibernatedConfig;
+	std::string hibernatedSearch;
+	unsigned int hibernations;
+	unsigned int restores;
+	double lastRestore;
+
 	//bool isFirstDecoding;
 };
 
-typedef struct AsyncData {
-  Recognizer* instance;
-  v8::Handle<v8::Value> exception;
-  bool hasException;
-  int16* data;
-  size_t length;
-  int32 score;
-  const char* hyp;
-} AsyncData;
+enum SearchType {
+	SEARCH_KEYPHRASE,
+	SEARCH_KEYWORDS,
+	SEARCH_GRAMMAR,
+	SEARCH_NGRAM
+};
+
+typedef struct SearchDefinition {
+	int type;
+	std::string name;
+	// Keyphrase or file the search was built from
+	std::string argument;
+} SearchDefinition;
+
+typedef struct Segment {
+	std::string word;
+	int32 start;
+	int32 end;
+	double prob;
+} Segment;
+
+typedef struct DecodeFileData {
+	uv_work_t request;
+	Recognizer* instance;
+	v8::Persistent<v8::Function> callback;
+	std::string path;
+	bool raw;
+	// Longest utterance in frames, the file is split at pauses and after this many frames of speech
+	int32 maxFrames;
+	const char* error;
+	std::string hyp;
+	int32 score;
+	int32 frameRate;
+	std::vector<Segment> segments;
+	// Frames decoded in the utterances before the current one, its segments start there
+	int32 offset;
+	size_t utterances;
+	// Most frames one utterance held, the backpointer table and lattice grow with it and not with the file
+	int32 peakFrames;
+	double audioDuration;
+	double decodeDuration;
+} DecodeFileData;
+
+typedef struct ModelConversionData {
+	uv_work_t request;
+	AddonData* addon;
+	// Empty for conversions started in the background by CachedNgram
+	v8::Persistent<v8::Function> callback;
+	std::string path;
+	std::string target;
+	const char* error;
+} ModelConversionData;
+
+typedef struct RestoreData {
+	DecoderJob job;
+	// Copies of what the hibernated decoder is rebuilt from, the Recognizer may change meanwhile
+	cmd_ln_t* config;
+	std::vector<std::pair<std::string, std::string> > words;
+	std::vector<SearchDefinition> searches;
+	std::string search;
+	bool spotting;
+	KeywordList keywords;
+	ps_decoder_t* ps;
+	const char* error;
+	double duration;
+} RestoreData;
+
+typedef struct ReplayData {
+	// One record at a time, the next one is queued from the after callback of the last
+	DecoderJob job;
+	v8::Persistent<v8::Function> callback;
+	std::string path;
+	// Waits for the recorded timestamps instead of decoding as fast as possible
+	bool realtime;
+	SessionReader reader;
+	bool opened;
+	bool configured;
+	// No record left, or the one that was read could not be applied
+	bool ended;
+	const char* error;
+	SessionRecord record;
+	// Chunks are decoded and delivered like written ones
+	AsyncData* chunk;
+	// What the record added on the pool thread, remembered by the Recognizer on the loop thread
+	SearchDefinition search;
+	std::vector<std::pair<std::string, std::string> > words;
+	std::string keywordsName;
+	KeywordList keywords;
+	uint64_t origin;
+	size_t records;
+	size_t chunks;
+	size_t pruning;
+	std::vector<std::string> hyps;
+	double audioDuration;
+	double decodeDuration;
+	double wallDuration;
+} ReplayData;
+
+typedef struct ChannelJob {
+	uv_work_t request;
+	struct MultiChannelData* parent;
+	int channel;
+	ps_decoder_t* ps;
+	const char* error;
+	std::string hyp;
+	int32 score;
+	std::vector<Segment> segments;
+} ChannelJob;
+
+typedef struct MultiChannelData {
+	// Creates the missing decoders before the channel jobs are queued
+	uv_work_t request;
+	Recognizer* instance;
+	v8::Persistent<v8::Function> callback;
+	// Interleaved samples, pinned until every channel finished
+	v8::Persistent<v8::Object> buffer;
+	const int16* data;
+	// Samples per channel
+	size_t frames;
+	int channels;
+	const char* error;
+	int pending;
+	int32 frameRate;
+	float32 sampleRate;
+	uint64_t start;
+	// Search of the Recognizer, selected in every channel decoder, with a copy of its keyword list
+	std::string search;
+	bool keywords;
+	KeywordList keywordList;
+	std::vector<ChannelJob> jobs;
+} MultiChannelData;
+
+typedef struct ConfidenceData {
+	uv_work_t request;
+	Recognizer* instance;
+	v8::Persistent<v8::Function> callback;
+	std::string hyp;
+	// Posterior probability of the hypothesis, between 0 and 1
+	double prob;
+	// With the posterior probability of every word as prob
+	std::vector<Segment> segments;
+	int32 frameRate;
+} ConfidenceData;
+
+typedef struct AlignJob {
+	const int16* data;
+	size_t length;
+	std::vector<std::string> words;
+	const char* error;
+	// Start and end frame of every transcript word
+	std::vector<int32> start;
+	std::vector<int32> end;
+} AlignJob;
+
+typedef struct AlignThread {
+	uv_work_t request;
+	struct AlignBatch* batch;
+	ps_decoder_t* ps;
+} AlignThread;
+
+typedef struct AlignBatch {
+	// Creates the missing decoders before the threads are queued
+	uv_work_t request;
+	Recognizer* instance;
+	v8::Persistent<v8::Function> callback;
+	// Keeps the audio buffers of all jobs alive
+	v8::Persistent<v8::Array> buffers;
+	std::vector<AlignJob> jobs;
+	std::vector<AlignThread> threads;
+	// Threads take the next job under lock, long and short jobs even out
+	uv_mutex_t lock;
+	size_t next;
+	int pending;
+	bool silence;
+	const char* error;
+	int32 frameRate;
+	uint64_t start;
+} AlignBatch;
+
+typedef struct RescoreData {
+	uv_work_t request;
+	Recognizer* instance;
+	Rescorer lattice;
+	SharedNgram* lm;
+	float32 lw;
+	const char* error;
+	std::string hyp;
+} RescoreData;
 
 #endif
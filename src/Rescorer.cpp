@@ -0,0 +1,158 @@
+#include <string.h>
+#include "Rescorer.h"
+
+#include <algorithm>
+#include <map>
+
+using namespace std;
+
+// Orders links by the start frame of their from node
+struct LinkOrder {
+	const vector<int32>& starts;
+	explicit LinkOrder(const vector<int32>& starts) : starts(starts) {}
+	bool operator()(size_t a, size_t b) const { return starts[a] < starts[b]; }
+};
+
+static bool IsFiller(const char* word) {
+	if(strcmp(word, "<s>") == 0 || strcmp(word, "</s>") == 0)
+		return false;
+	return word[0] == '<' || word[0] == '[' || word[0] == '+';
+}
+
+bool Rescorer::Copy(ps_lattice_t* dag) {
+	nodes.clear();
+	links.clear();
+
+	map<ps_latnode_t*, size_t> index;
+	for(ps_latnode_iter_t* it = ps_latnode_iter(dag); it != NULL; it = ps_latnode_iter_next(it)) {
+		ps_latnode_t* latnode = ps_latnode_iter_node(it);
+		int16 firstEnd, lastEnd;
+		Node node;
+		node.word.assign(ps_latnode_baseword(dag, latnode));
+		node.start = ps_latnode_times(latnode, &firstEnd, &lastEnd);
+		node.filler = IsFiller(node.word.c_str());
+		index[latnode] = nodes.size();
+		nodes.push_back(node);
+	}
+
+	if(nodes.empty())
+		return false;
+
+	// The start node is the only one without entries, the end node the only one without exits
+	start = end = nodes.size();
+	for(map<ps_latnode_t*, size_t>::iterator node = index.begin(); node != index.end(); ++node) {
+		ps_latlink_iter_t* exits = ps_latnode_exits(node->first);
+		if(exits == NULL && (end == nodes.size() || nodes[node->second].start > nodes[end].start))
+			end = node->second;
+		for(ps_latlink_iter_t* it = exits; it != NULL; it = ps_latlink_iter_next(it)) {
+			ps_latnode_t* from;
+			ps_latlink_t* latlink = ps_latlink_iter_link(it);
+			ps_latnode_t* to = ps_latlink_nodes(latlink, &from);
+			if(!index.count(to))
+				continue;
+			Link link;
+			link.from = node->second;
+			link.to = index[to];
+			ps_latlink_prob(dag, latlink, &link.ascr);
+			nodes[link.to].entries.push_back(links.size());
+			links.push_back(link);
+		}
+	}
+
+	for(size_t i = 0; i < nodes.size(); i++) {
+		if(nodes[i].entries.empty() && (start == nodes.size() || nodes[i].start < nodes[start].start))
+			start = i;
+	}
+
+	return start < nodes.size() && end < nodes.size();
+}
+
+const char* Rescorer::Rescore(ngram_model_t* lm, float32 lw, string& hyp) {
+	// Links only go forward in time, in the order of their start node every
+	// predecessor of a link is done before it
+	vector<size_t> order(links.size());
+	vector<int32> starts(links.size());
+	for(size_t i = 0; i < order.size(); i++) {
+		order[i] = i;
+		starts[i] = nodes[links[i].from].start;
+	}
+	sort(order.begin(), order.end(), LinkOrder(starts));
+
+	// Viterbi over the links with a trigram history of the last two real words
+	const double none = -1e300;
+	vector<double> score(links.size(), none);
+	vector<size_t> pred(links.size(), links.size());
+	vector<int32> history1(links.size(), -1);
+	vector<int32> history2(links.size(), -1);
+	vector<int32> wids(nodes.size());
+	for(size_t i = 0; i < nodes.size(); i++)
+		wids[i] = ngram_wid(lm, nodes[i].word.c_str());
+
+	for(size_t o = 0; o < order.size(); o++) {
+		size_t l = order[o];
+		const Link& link = links[l];
+		const Node& to = nodes[link.to];
+
+		// Candidates are the entries of the from node, or the sentence start
+		size_t candidates = link.from == start ? 1 : nodes[link.from].entries.size();
+		for(size_t c = 0; c < candidates; c++) {
+			size_t p = link.from == start ? links.size() : nodes[link.from].entries[c];
+			double base;
+			int32 h1, h2;
+			if(p == links.size()) {
+				base = 0;
+				h1 = wids[start];
+				h2 = -1;
+			} else {
+				if(score[p] == none)
+					continue;
+				base = score[p];
+				h1 = history1[p];
+				h2 = history2[p];
+			}
+
+			double lmScore = 0;
+			int32 n1 = h1, n2 = h2;
+			if(!to.filler) {
+				int32 used;
+				lmScore = h2 < 0 ? ngram_bg_score(lm, wids[link.to], h1, &used) : ngram_tg_score(lm, wids[link.to], h1, h2, &used);
+				n1 = wids[link.to];
+				n2 = h1;
+			}
+
+			double candidate = base + link.ascr + lw * lmScore;
+			if(candidate > score[l]) {
+				score[l] = candidate;
+				pred[l] = p;
+				history1[l] = n1;
+				history2[l] = n2;
+			}
+		}
+	}
+
+	size_t best = links.size();
+	for(size_t i = 0; i < nodes[end].entries.size(); i++) {
+		size_t l = nodes[end].entries[i];
+		if(score[l] != none && (best == links.size() || score[l] > score[best]))
+			best = l;
+	}
+	if(best == links.size())
+		return "Failed to rescore lattice";
+
+	// Walk back from the end, every link contributes the word of its from node
+	vector<const string*> words;
+	for(size_t l = best; l != links.size(); l = pred[l]) {
+		const Node& from = nodes[links[l].from];
+		if(links[l].from != start && !from.filler)
+			words.push_back(&from.word);
+	}
+
+	hyp.clear();
+	for(size_t i = words.size(); i-- > 0;) {
+		if(!hyp.empty())
+			hyp.push_back(' ');
+		hyp.append(*words[i]);
+	}
+
+	return NULL;
+}
@@ -0,0 +1,45 @@
+#ifndef RESCORER_H
+#define RESCORER_H
+
+#include <pocketsphinx.h>
+
+#include <string>
+#include <vector>
+
+// Copy of a word lattice that no longer depends on the decoder, so the decoder can go on
+// with the next utterance, change its search or add words while the copy is rescored
+class Rescorer
+{
+public:
+	// Copies words, start frames and acoustic scores of the lattice, loop thread only
+	bool Copy(ps_lattice_t* dag);
+
+	// Best path under the given language model, returns an error message or NULL
+	const char* Rescore(ngram_model_t* lm, float32 lw, std::string& hyp);
+
+	size_t Nodes() const { return nodes.size(); }
+	size_t Links() const { return links.size(); }
+
+private:
+	typedef struct Node {
+		std::string word;
+		int32 start;
+		// Silences and noises keep the language model context of the word before them
+		bool filler;
+		std::vector<size_t> entries;
+	} Node;
+
+	typedef struct Link {
+		size_t from;
+		size_t to;
+		// Acoustic score of the word of the from node
+		int32 ascr;
+	} Link;
+
+	std::vector<Node> nodes;
+	std::vector<Link> links;
+	size_t start;
+	size_t end;
+};
+
+#endif
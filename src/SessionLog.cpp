@@ -0,0 +1,240 @@
+#include <uv.h>
+#include <stdio.h>
+#include <string.h>
+#include "SessionLog.h"
+
+using namespace std;
+
+static const char magic[8] = { 'P', 'S', 'S', 'E', 'S', 'S', '0', '1' };
+
+typedef struct RecordHeader {
+	uint8 type;
+	uint8 reserved[3];
+	uint32 length;
+	uint64_t time;
+} RecordHeader;
+
+SessionRecorder::SessionRecorder() : file(NULL), origin(0), records(0), failed(false) {
+
+}
+
+SessionRecorder::~SessionRecorder() {
+	Close();
+}
+
+bool SessionRecorder::Open(const char* path) {
+	Close();
+
+	file = fopen(path, "wb");
+	if(file == NULL)
+		return false;
+
+	origin = uv_hrtime();
+	records = 0;
+	failed = fwrite(magic, 1, sizeof(magic), file) != sizeof(magic);
+	return true;
+}
+
+bool SessionRecorder::Close() {
+	if(file == NULL)
+		return true;
+
+	bool written = !failed && fclose(file) == 0;
+	if(failed)
+		fclose(file);
+	file = NULL;
+	return written;
+}
+
+void SessionRecorder::Chunk(const int16* data, size_t samples, uint64_t arrived) {
+	Append(SESSION_CHUNK, data, uint32(samples * sizeof(int16)), arrived);
+}
+
+void SessionRecorder::Control(SessionRecordType type, const char* text) {
+	Append(type, text, text != NULL ? uint32(strlen(text)) : 0);
+}
+
+void SessionRecorder::Config(cmd_ln_t* config) {
+	// Pairs of zero terminated name and value, in the form cmd_ln_parse_r takes them
+	string payload;
+	char value[64];
+	for(const arg_t* arg = ps_args(); arg->name != NULL; arg++) {
+		if(!cmd_ln_exists_r(config, arg->name))
+			continue;
+
+		if(arg->type & ARG_INTEGER) {
+			snprintf(value, sizeof(value), "%ld", cmd_ln_int_r(config, arg->name));
+		} else if(arg->type & ARG_FLOATING) {
+			snprintf(value, sizeof(value), "%.17g", cmd_ln_float_r(config, arg->name));
+		} else if(arg->type & ARG_BOOLEAN) {
+			snprintf(value, sizeof(value), "%s", cmd_ln_boolean_r(config, arg->name) ? "yes" : "no");
+		} else if(arg->type & ARG_STRING) {
+			const char* str = cmd_ln_str_r(config, arg->name);
+			if(str == NULL)
+				continue;
+			payload.append(arg->name).push_back('\0');
+			payload.append(str).push_back('\0');
+			continue;
+		} else {
+			continue;
+		}
+
+		payload.append(arg->name).push_back('\0');
+		payload.append(value).push_back('\0');
+	}
+
+	Append(SESSION_CONFIG, payload.data(), uint32(payload.size()));
+}
+
+void SessionRecorder::Search(int type, const char* name, const char* argument) {
+	char value[16];
+	snprintf(value, sizeof(value), "%d", type);
+
+	vector<string> fields;
+	fields.push_back(value);
+	fields.push_back(name);
+	fields.push_back(argument);
+	Append(SESSION_ADD_SEARCH, fields);
+}
+
+void SessionRecorder::Words(const vector<pair<string, string> >& words) {
+	if(words.empty())
+		return;
+
+	// Word and pronunciation of every entry
+	vector<string> fields;
+	for(size_t i = 0; i < words.size(); i++) {
+		fields.push_back(words[i].first);
+		fields.push_back(words[i].second);
+	}
+	Append(SESSION_ADD_WORDS, fields);
+}
+
+void SessionRecorder::Keywords(const char* name, const map<string, double>& thresholds) {
+	// The name, then phrase and threshold of every keyword
+	vector<string> fields;
+	fields.push_back(name);
+	char value[64];
+	for(map<string, double>::const_iterator it = thresholds.begin(); it != thresholds.end(); ++it) {
+		snprintf(value, sizeof(value), "%.17g", it->second);
+		fields.push_back(it->first);
+		fields.push_back(value);
+	}
+	Append(SESSION_KEYWORDS, fields);
+}
+
+void SessionRecorder::Pruning(double beam, double wbeam, double pbeam, long maxhmmpf) {
+	char value[64];
+	vector<string> fields;
+	snprintf(value, sizeof(value), "%.17g", beam);
+	fields.push_back(value);
+	snprintf(value, sizeof(value), "%.17g", wbeam);
+	fields.push_back(value);
+	snprintf(value, sizeof(value), "%.17g", pbeam);
+	fields.push_back(value);
+	snprintf(value, sizeof(value), "%ld", maxhmmpf);
+	fields.push_back(value);
+	Append(SESSION_PRUNING, fields);
+}
+
+void SessionRecorder::Append(uint8 type, const vector<string>& fields) {
+	string payload;
+	for(size_t i = 0; i < fields.size(); i++) {
+		payload.append(fields[i]).push_back('\0');
+	}
+	Append(type, payload.data(), uint32(payload.size()));
+}
+
+void SessionRecorder::Append(uint8 type, const void* payload, uint32 length, uint64_t time) {
+	if(file == NULL || failed)
+		return;
+
+	RecordHeader header;
+	memset(&header, 0, sizeof(header));
+	header.type = type;
+	header.length = length;
+	// Chunks that arrived before record() count from its start
+	if(time == 0)
+		time = uv_hrtime();
+	header.time = time > origin ? time - origin : 0;
+
+	if(fwrite(&header, sizeof(header), 1, file) != 1 || (length > 0 && fwrite(payload, 1, length, file) != length)) {
+		failed = true;
+		return;
+	}
+	records++;
+}
+
+SessionReader::SessionReader() : file(NULL), error(NULL) {
+
+}
+
+SessionReader::~SessionReader() {
+	if(file != NULL)
+		fclose(file);
+}
+
+bool SessionReader::Open(const char* path) {
+	file = fopen(path, "rb");
+	if(file == NULL) {
+		error = "Could not open session file";
+		return false;
+	}
+
+	char header[sizeof(magic)];
+	if(fread(header, 1, sizeof(header), file) != sizeof(header) || memcmp(header, magic, sizeof(magic)) != 0) {
+		error = "Not a session file";
+		return false;
+	}
+
+	return true;
+}
+
+bool SessionReader::Next(SessionRecord* record) {
+	RecordHeader header;
+	size_t read = fread(&header, 1, sizeof(header), file);
+	if(read == 0)
+		return false;
+
+	if(read != sizeof(header)) {
+		error = "Session file is truncated";
+		return false;
+	}
+
+	record->type = header.type;
+	record->time = header.time;
+	record->payload.resize(header.length);
+	if(header.length > 0 && fread(&record->payload[0], 1, header.length, file) != header.length) {
+		error = "Session file is truncated";
+		return false;
+	}
+
+	return true;
+}
+
+cmd_ln_t* SessionReader::Config(const SessionRecord& record) {
+	vector<string> fields;
+	if(!Fields(record, &fields) || fields.empty() || fields.size() % 2 != 0)
+		return NULL;
+
+	vector<char*> argv;
+	for(size_t i = 0; i < fields.size(); i++) {
+		argv.push_back(&fields[i][0]);
+	}
+
+	return cmd_ln_parse_r(NULL, ps_args(), int32(argv.size()), &argv[0], FALSE);
+}
+
+bool SessionReader::Fields(const SessionRecord& record, vector<string>* fields) {
+	fields->clear();
+	if(record.payload.empty() || record.payload.back() != '\0')
+		return false;
+
+	const char* payload = record.payload.data();
+	size_t offset = 0;
+	while(offset < record.payload.size()) {
+		fields->push_back(payload + offset);
+		offset += fields->back().size() + 1;
+	}
+	return true;
+}
@@ -0,0 +1,91 @@
+#ifndef SESSIONLOG_H
+#define SESSIONLOG_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pocketsphinx.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+enum SessionRecordType {
+	SESSION_CHUNK = 1,
+	SESSION_START,
+	SESSION_STOP,
+	SESSION_RESTART,
+	SESSION_SEARCH,
+	SESSION_CONFIG,
+	SESSION_ADD_SEARCH,
+	SESSION_ADD_WORDS,
+	SESSION_KEYWORDS,
+	SESSION_PRUNING
+};
+
+typedef struct SessionRecord {
+	uint8 type;
+	// Nanoseconds since the recording started
+	uint64_t time;
+	std::vector<char> payload;
+} SessionRecord;
+
+// Appends the audio chunks and control calls of a Recognizer to a file, so the session can be replayed.
+// Records are a fixed header followed by the payload, in host byte order.
+class SessionRecorder
+{
+public:
+	SessionRecorder();
+	~SessionRecorder();
+
+	bool Open(const char* path);
+	// Returns false when a record could not be written
+	bool Close();
+	bool IsOpen() const { return file != NULL; }
+
+	// Chunks are appended once decoded, arrived is the uv_hrtime of the write() call
+	void Chunk(const int16* data, size_t samples, uint64_t arrived = 0);
+	void Control(SessionRecordType type, const char* text = NULL);
+	// Stores every argument of the configuration, replaying it reinitializes the decoder the same way
+	void Config(cmd_ln_t* config);
+	// Searches, words and keyword lists added at runtime, so the replay decoder has them as well
+	void Search(int type, const char* name, const char* argument);
+	void Words(const std::vector<std::pair<std::string, std::string> >& words);
+	void Keywords(const char* name, const std::map<std::string, double>& thresholds);
+	// Beams the pruning controller rebuilt the active search with, replays use them instead of measuring
+	void Pruning(double beam, double wbeam, double pbeam, long maxhmmpf);
+
+	size_t Records() const { return records; }
+
+private:
+	void Append(uint8 type, const void* payload, uint32 length, uint64_t time = 0);
+	void Append(uint8 type, const std::vector<std::string>& fields);
+
+	FILE* file;
+	uint64_t origin;
+	size_t records;
+	bool failed;
+};
+
+// Reads the records written by SessionRecorder, without V8 so it can run on pool threads
+class SessionReader
+{
+public:
+	SessionReader();
+	~SessionReader();
+
+	bool Open(const char* path);
+	// Returns false at the end of the file or when it is truncated, Error tells which
+	bool Next(SessionRecord* record);
+	const char* Error() const { return error; }
+
+	// Parses the payload of a SESSION_CONFIG record, the caller owns the returned config
+	static cmd_ln_t* Config(const SessionRecord& record);
+	// Splits the zero terminated strings the other records carry, false when the payload is malformed
+	static bool Fields(const SessionRecord& record, std::vector<std::string>* fields);
+
+private:
+	FILE* file;
+	const char* error;
+};
+
+#endif
@@ -0,0 +1,403 @@
+#include <node.h>
+#include <stdlib.h>
+#include "Recognizer.h"
+
+using namespace v8;
+using namespace std;
+
+void Recognizer::Record(const FunctionCallbackInfo<Value>& args) {
+	Isolate* isolate = args.GetIsolate();
+	HandleScope scope(isolate);
+	Recognizer* instance = node::ObjectWrap::Unwrap<Recognizer>(args.Holder());
+
+	if(!Ready(instance, isolate, true)) {
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	if(args.Length() < 1 || !(args[0]->IsString() || (args[0]->IsBoolean() && !args[0]->BooleanValue(isolate)))) {
+		Recognizer::TypeError(instance, isolate, "Expected path to be a string or false");
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	if(!instance->recorder.Close()) {
+		Recognizer::Error(instance, isolate, "Failed to write session file");
+	}
+
+	if(args[0]->IsString()) {
+		if(!instance->recorder.Open(*String::Utf8Value(isolate, args[0]))) {
+			Recognizer::Error(instance, isolate, "Could not open session file");
+			args.GetReturnValue().Set(args.Holder());
+			return;
+		}
+
+		// Replays start from the state the decoder is in right now, the words and searches
+		// added at runtime go in the order a restored decoder adds them
+		instance->recorder.Config(DecoderConfig(instance));
+		instance->recorder.Words(instance->addedWords);
+		for(size_t i = 0; i < instance->searches.size(); i++) {
+			const SearchDefinition& search = instance->searches[i];
+			instance->recorder.Search(search.type, search.name.c_str(), search.argument.c_str());
+		}
+		// Lists with pending edits are recorded once they are applied
+		for(map<string, KeywordList>::iterator it = instance->keywordLists.begin(); it != instance->keywordLists.end(); ++it) {
+			if(!it->second.Dirty()) {
+				instance->recorder.Keywords(it->first.c_str(), it->second.Thresholds());
+			}
+		}
+		// A decoder that is still being restored is described by what it is restored from
+		const char* search = ActiveSearch(instance);
+		if(search[0] != '\0') {
+			instance->recorder.Control(SESSION_SEARCH, search);
+		}
+		// The search may run with the beams of a pruning level already
+		if(instance->pruning.Level() != 0) {
+			PruningController& pruning = instance->pruning;
+			instance->recorder.Pruning(pruning.Beam(), pruning.WordBeam(), pruning.PhoneBeam(), pruning.MaxHmmPerFrame());
+		}
+		if(instance->processing) {
+			instance->recorder.Control(SESSION_START);
+		}
+	}
+
+	args.GetReturnValue().Set(args.Holder());
+}
+
+void Recognizer::Replay(const FunctionCallbackInfo<Value>& args) {
+	Isolate* isolate = args.GetIsolate();
+	HandleScope scope(isolate);
+	Local<Context> context = isolate->GetCurrentContext();
+	Recognizer* instance = node::ObjectWrap::Unwrap<Recognizer>(args.Holder());
+
+	// The session is played into the decoder of the Recognizer, nothing else may use it meanwhile
+	if(!Ready(instance, isolate)) {
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	if(args.Length() < 2) {
+		Recognizer::TypeError(instance, isolate, "Incorrect number of arguments, expected path and callback");
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	Local<Value> options = args.Length() >= 3 ? args[1] : Local<Value>::Cast(Undefined(isolate));
+	Local<Value> callback = args[args.Length() >= 3 ? 2 : 1];
+
+	if(!args[0]->IsString() || !callback->IsFunction() || !(options->IsUndefined() || options->IsObject())) {
+		Recognizer::TypeError(instance, isolate, "Expected path to be a string, options to be an object and callback to be a function");
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	if(instance->processing) {
+		Recognizer::Error(instance, isolate, "Stop the recognizer before replaying a session");
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	ReplayData* data = new ReplayData();
+	data->job.data = data;
+	data->job.work = ReplayWorker;
+	data->job.after = ReplayAfter;
+	data->callback.Reset(isolate, Local<Function>::Cast(callback));
+	data->path = *String::Utf8Value(isolate, args[0]);
+	data->realtime = false;
+	if(options->IsObject()) {
+		Local<Value> realtime = options.As<Object>()->Get(context, NewString(isolate, "realtime")).ToLocalChecked();
+		data->realtime = realtime->IsBoolean() && realtime->BooleanValue(isolate);
+	}
+	data->opened = false;
+	data->configured = false;
+	data->ended = false;
+	data->error = NULL;
+	data->chunk = instance->addon->jobPool.Acquire(false);
+	data->origin = 0;
+	data->records = 0;
+	data->chunks = 0;
+	data->pruning = 0;
+	data->audioDuration = 0;
+	data->decodeDuration = 0;
+	data->wallDuration = 0;
+
+	// Events are delivered as during the recorded session, calls from their handlers are refused
+	instance->busy = true;
+	instance->replaying = data;
+	instance->queue.Push(&data->job);
+
+	args.GetReturnValue().Set(args.Holder());
+}
+
+void Recognizer::ReplayWorker(DecoderJob* job) {
+	ReplayData* data = reinterpret_cast<ReplayData*>(job->data);
+	Recognizer* instance = job->instance;
+	TraceSpan span("decode", "replay", instance->traceId);
+
+	// free() was queued before this record, the after callback reports it
+	if(instance->destructed)
+		return;
+
+	if(!data->opened) {
+		data->opened = true;
+		data->origin = uv_hrtime();
+		if(!data->reader.Open(data->path.c_str())) {
+			data->error = data->reader.Error();
+			return;
+		}
+	}
+
+	SessionRecord& record = data->record;
+	if(!data->reader.Next(&record)) {
+		data->ended = true;
+		data->error = data->reader.Error();
+		return;
+	}
+	data->records++;
+
+	// Keep the gaps between the recorded calls
+	if(data->realtime) {
+		uint64_t elapsed = uv_hrtime() - data->origin;
+		if(record.time > elapsed) {
+			uv_sleep((unsigned int)((record.time - elapsed) / 1000000));
+		}
+	}
+
+	// Built from the first recorded configuration, so replays of a session always start from the same decoder
+	if(!data->configured && record.type != SESSION_CONFIG) {
+		data->error = "Session file does not start with a configuration";
+		return;
+	}
+
+	uint64_t start = uv_hrtime();
+	vector<string> fields;
+	switch(record.type) {
+	case SESSION_CHUNK: {
+		// Only the loop thread changes processing, and never while a job runs
+		AsyncData* chunk = data->chunk;
+		chunk->length = record.payload.size() / sizeof(int16);
+		chunk->decoded = instance->processing && chunk->length > 0;
+		if(!chunk->decoded)
+			break;
+		chunk->data = reinterpret_cast<int16*>(record.payload.data());
+		chunk->duration = AudioDuration(instance, chunk->length);
+		chunk->spotting = ActiveKeywords(instance) != NULL;
+		DecodeChunk(instance, chunk);
+		break;
+	}
+	case SESSION_START:
+	case SESSION_STOP:
+	case SESSION_RESTART:
+		// Run on the loop thread, they emit events
+		break;
+	case SESSION_SEARCH: {
+		string search(record.payload.begin(), record.payload.end());
+		if(ps_set_search(instance->ps, search.c_str()) < 0) {
+			data->error = "Session switches to an unknown search";
+		}
+		break;
+	}
+	case SESSION_CONFIG: {
+		cmd_ln_t* config = SessionReader::Config(record);
+		// Reinitializing drops the searches and words added before, like reconfig does
+		if(config == NULL || ps_reinit(instance->ps, config) < 0) {
+			data->error = "Could not reinit decoder";
+		}
+		if(config != NULL) {
+			cmd_ln_free_r(config);
+		}
+		data->configured = true;
+		break;
+	}
+	case SESSION_ADD_SEARCH: {
+		if(!SessionReader::Fields(record, &fields) || fields.size() != 3) {
+			data->error = "Unknown record in session file";
+			break;
+		}
+		data->search.type = atoi(fields[0].c_str());
+		data->search.name = fields[1];
+		data->search.argument = fields[2];
+		if(AddSearch(instance->ps, data->search) < 0) {
+			data->error = "Session adds a search that can not be built";
+		}
+		break;
+	}
+	case SESSION_ADD_WORDS: {
+		if(!SessionReader::Fields(record, &fields) || fields.empty() || fields.size() % 2 != 0) {
+			data->error = "Unknown record in session file";
+			break;
+		}
+		data->words.clear();
+		for(size_t i = 0; i < fields.size(); i += 2) {
+			if(ps_add_word(instance->ps, fields[i].c_str(), fields[i + 1].c_str(), i + 2 == fields.size()) >= 0) {
+				data->words.push_back(make_pair(fields[i], fields[i + 1]));
+			}
+		}
+		break;
+	}
+	case SESSION_KEYWORDS: {
+		if(!SessionReader::Fields(record, &fields) || fields.size() % 2 != 1) {
+			data->error = "Unknown record in session file";
+			break;
+		}
+		data->keywordsName = fields[0];
+		data->keywords.Clear();
+		for(size_t i = 1; i < fields.size(); i += 2) {
+			data->keywords.Set(fields[i], atof(fields[i + 1].c_str()));
+		}
+		data->error = data->keywords.Apply(instance->ps, data->keywordsName.c_str());
+		break;
+	}
+	case SESSION_PRUNING: {
+		if(!SessionReader::Fields(record, &fields) || fields.size() != 4) {
+			data->error = "Unknown record in session file";
+			break;
+		}
+		// The live pruning controller is left out, the search gets the beams the session had
+		if(PruningController::Rebuild(instance->ps, atof(fields[0].c_str()), atof(fields[1].c_str()), atof(fields[2].c_str()), atol(fields[3].c_str()))) {
+			data->pruning++;
+		}
+		break;
+	}
+	default:
+		data->error = "Unknown record in session file";
+	}
+	data->decodeDuration += (uv_hrtime() - start) / 1e6;
+}
+
+void Recognizer::ReplayAfter(DecoderJob* job) {
+	ReplayData* data = reinterpret_cast<ReplayData*>(job->data);
+	Recognizer* instance = job->instance;
+	Isolate* isolate = instance->addon->isolate;
+	HandleScope scope(isolate);
+
+	if(instance->destructed || data->error != NULL || data->ended) {
+		FinishReplay(data);
+		return;
+	}
+
+	switch(data->record.type) {
+	case SESSION_CHUNK: {
+		AsyncData* chunk = data->chunk;
+		if(!chunk->decoded)
+			break;
+		data->chunks++;
+		data->audioDuration += chunk->duration * 1000;
+		instance->pruning.Measure(chunk->decodeTime, chunk->duration);
+
+		// The same events as a written chunk
+		instance->traceChunk = chunk->chunk;
+		if(chunk->hasException) {
+			EventArg argv[1];
+			argv[0].SetError(chunk->exception);
+			Emit(instance, isolate, "hyp", instance->hypCallback, 1, argv);
+		} else {
+			DeliverChunk(instance, isolate, chunk);
+		}
+		instance->traceChunk = 0;
+
+		instance->addon->jobPool.Release(chunk);
+		data->chunk = instance->addon->jobPool.Acquire(false);
+		break;
+	}
+	case SESSION_START:
+		StartUtterance(instance, isolate);
+		break;
+	case SESSION_STOP:
+		StopUtterance(instance, isolate);
+		break;
+	case SESSION_RESTART:
+		RestartUtterance(instance, isolate);
+		break;
+	case SESSION_SEARCH:
+		instance->pruning.SearchChanged();
+		break;
+	case SESSION_CONFIG:
+		// The recorded configuration is the one of the Recognizer from now on
+		instance->processing = false;
+		ForgetDecoderState(instance);
+		FreeChannels(instance);
+		UpdateMemory(instance);
+		if(instance->pruning.Enabled()) {
+			instance->pruning.Enable(instance->ps, instance->pruning.Target(), instance->pruning.MaxLevel());
+		}
+		break;
+	case SESSION_ADD_SEARCH:
+		RememberSearch(instance, data->search.type, data->search.name.c_str(), data->search.argument.c_str());
+		break;
+	case SESSION_ADD_WORDS:
+		for(size_t i = 0; i < data->words.size(); i++) {
+			instance->addedWords.push_back(data->words[i]);
+		}
+		break;
+	case SESSION_KEYWORDS:
+		// Applied already, selecting it doesn't build it again
+		instance->keywordLists[data->keywordsName] = data->keywords;
+		break;
+	}
+
+	// Handlers may have freed the Recognizer
+	if(instance->destructed) {
+		FinishReplay(data);
+		return;
+	}
+
+	instance->queue.Push(&data->job);
+}
+
+void Recognizer::FinishReplay(ReplayData* data) {
+	Recognizer* instance = data->job.instance;
+	AddonData* addon = instance->addon;
+	Isolate* isolate = addon->isolate;
+	HandleScope scope(isolate);
+	Local<Context> context = isolate->GetCurrentContext();
+
+	// Sessions recorded up to the middle of an utterance are finished like a stop
+	if(!instance->destructed && data->error == NULL && instance->processing) {
+		StopUtterance(instance, isolate);
+	}
+	if(instance->destructed && data->error == NULL) {
+		data->error = "Recognizer was freed";
+	}
+
+	instance->busy = false;
+	instance->replaying = NULL;
+	addon->jobPool.Release(data->chunk);
+	data->wallDuration = data->origin != 0 ? (uv_hrtime() - data->origin) / 1e6 : 0;
+
+	Local<Function> cb = Local<Function>::New(isolate, data->callback);
+	if(data->error != NULL) {
+		Local<Value> argv[1] = { Exception::Error(NewString(isolate, data->error)) };
+		CallFunction(isolate, cb, 1, argv);
+	} else {
+		Local<Array> hyps = Array::New(isolate, int(data->hyps.size()));
+		for(size_t i = 0; i < data->hyps.size(); i++) {
+			hyps->Set(context, i, NewString(isolate, data->hyps[i].c_str())).Check();
+		}
+
+		Local<Object> result = Object::New(isolate);
+		result->Set(context, NewString(isolate, "records"), Number::New(isolate, double(data->records))).Check();
+		result->Set(context, NewString(isolate, "chunks"), Number::New(isolate, double(data->chunks))).Check();
+		result->Set(context, NewString(isolate, "hyps"), hyps).Check();
+		result->Set(context, NewString(isolate, "pruning"), Number::New(isolate, double(data->pruning))).Check();
+		result->Set(context, NewString(isolate, "audioDuration"), Number::New(isolate, data->audioDuration)).Check();
+		result->Set(context, NewString(isolate, "decodeDuration"), Number::New(isolate, data->decodeDuration)).Check();
+		result->Set(context, NewString(isolate, "wallDuration"), Number::New(isolate, data->wallDuration)).Check();
+
+		Local<Value> argv[2] = { Null(isolate), result };
+		CallFunction(isolate, cb, 2, argv);
+	}
+
+	// The queue holds the Recognizer until this job is done
+	data->callback.Reset();
+	delete data;
+}
+
+void Recognizer::ReplayUtteranceEnded(Recognizer* instance) {
+	if(instance->replaying == NULL)
+		return;
+
+	int32 score;
+	const char* hyp = ps_get_hyp(instance->ps, &score);
+	instance->replaying->hyps.push_back(hyp ? hyp : "");
+}
@@ -0,0 +1,94 @@
+#include "SharedModels.h"
+#include "ModelCache.h"
+
+#include <map>
+
+using namespace std;
+
+static uv_once_t once = UV_ONCE_INIT;
+static uv_mutex_t registryLock;
+static map<pair<string, float64>, SharedNgram*> ngrams;
+
+void SharedModels::InitOnce() {
+	uv_mutex_init(&registryLock);
+}
+
+SharedNgram* SharedModels::Ngram(const char* path, float64 logbase) {
+	uv_once(&once, InitOnce);
+	uv_mutex_lock(&registryLock);
+
+	pair<string, float64> key(path, logbase);
+	SharedNgram* entry;
+	map<pair<string, float64>, SharedNgram*>::iterator it = ngrams.find(key);
+	if(it != ngrams.end()) {
+		entry = it->second;
+	} else {
+		entry = new SharedNgram();
+		entry->path = path;
+		entry->logbase = logbase;
+		entry->loaded = 0;
+		entry->limit = 1;
+		entry->lmath = NULL;
+		entry->error = NULL;
+		uv_mutex_init(&entry->lock);
+		uv_cond_init(&entry->available);
+		ngrams[key] = entry;
+	}
+
+	uv_mutex_unlock(&registryLock);
+	return entry;
+}
+
+void SharedModels::SetLimit(SharedNgram* entry, size_t limit) {
+	uv_mutex_lock(&entry->lock);
+	if(limit > entry->limit)
+		entry->limit = limit;
+	uv_mutex_unlock(&entry->lock);
+}
+
+ngram_model_t* SharedModels::Acquire(SharedNgram* entry) {
+	uv_mutex_lock(&entry->lock);
+	while(entry->error == NULL && entry->idle.empty() && entry->loaded >= entry->limit) {
+		uv_cond_wait(&entry->available, &entry->lock);
+	}
+
+	if(entry->error != NULL) {
+		uv_mutex_unlock(&entry->lock);
+		return NULL;
+	}
+
+	if(!entry->idle.empty()) {
+		ngram_model_t* lm = entry->idle.back();
+		entry->idle.pop_back();
+		uv_mutex_unlock(&entry->lock);
+		return lm;
+	}
+
+	// Own log table in the base of the decoders, so scores are comparable, shared by the copies
+	if(entry->lmath == NULL)
+		entry->lmath = logmath_init(entry->logbase, 0, TRUE);
+	logmath_t* lmath = entry->lmath;
+	entry->loaded++;
+	uv_mutex_unlock(&entry->lock);
+
+	// Others keep using the loaded copies meanwhile
+	string path = ModelCache::Ngram(entry->path.c_str());
+	ngram_model_t* lm = ngram_model_read(NULL, path.c_str(), NGRAM_AUTO, lmath);
+
+	if(lm == NULL) {
+		uv_mutex_lock(&entry->lock);
+		entry->loaded--;
+		entry->error = "Failed to load shared language model";
+		uv_cond_broadcast(&entry->available);
+		uv_mutex_unlock(&entry->lock);
+	}
+
+	return lm;
+}
+
+void SharedModels::Release(SharedNgram* entry, ngram_model_t* lm) {
+	uv_mutex_lock(&entry->lock);
+	entry->idle.push_back(lm);
+	uv_cond_signal(&entry->available);
+	uv_mutex_unlock(&entry->lock);
+}
@@ -0,0 +1,43 @@
+#ifndef SHAREDMODELS_H
+#define SHAREDMODELS_H
+
+#include <uv.h>
+#include <pocketsphinx.h>
+
+#include <string>
+#include <vector>
+
+// Language model shared by all threads of the process. The score caches of a model are not
+// thread safe, so every copy is used by one thread at a time and up to limit copies are loaded
+typedef struct SharedNgram {
+	std::string path;
+	float64 logbase;
+	uv_mutex_t lock;
+	uv_cond_t available;
+	std::vector<ngram_model_t*> idle;
+	size_t loaded;
+	size_t limit;
+	logmath_t* lmath;
+	// Set when loading failed, the model is not retried
+	const char* error;
+} SharedNgram;
+
+// Process wide registry of read only models, entries live as long as the process
+class SharedModels
+{
+public:
+	// Returns the entry for path and log base, the model itself is loaded by Acquire
+	static SharedNgram* Ngram(const char* path, float64 logbase);
+
+	// Raises the number of copies that may be loaded, never lowers it
+	static void SetLimit(SharedNgram* entry, size_t limit);
+
+	// Takes an idle copy, loads another one below the limit or waits for one, NULL on error
+	static ngram_model_t* Acquire(SharedNgram* entry);
+	static void Release(SharedNgram* entry, ngram_model_t* lm);
+
+private:
+	static void InitOnce();
+};
+
+#endif
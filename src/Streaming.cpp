@@ -0,0 +1,518 @@
+#include <node.h>
+#include <node_buffer.h>
+#include "Recognizer.h"
+
+using namespace v8;
+using namespace std;
+
+void Recognizer::Start(const FunctionCallbackInfo<Value>& args) {
+	Isolate* isolate = args.GetIsolate();
+	Recognizer* instance = node::ObjectWrap::Unwrap<Recognizer>(args.Holder());
+
+	if(!Ready(instance, isolate, true)) {
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	if(!instance->queue.Idle()) {
+		// Chunks written before still belong to the running utterance
+		QueueControl(instance, isolate, JOB_START);
+	} else {
+		StartUtterance(instance, isolate);
+	}
+
+	args.GetReturnValue().Set(args.Holder());
+}
+
+void Recognizer::Stop(const FunctionCallbackInfo<Value>& args) {
+	Isolate* isolate = args.GetIsolate();
+	Recognizer* instance = node::ObjectWrap::Unwrap<Recognizer>(args.Holder());
+
+	if(!instance->queue.Idle()) {
+		QueueControl(instance, isolate, JOB_STOP);
+	} else {
+		StopUtterance(instance, isolate);
+	}
+
+	args.GetReturnValue().Set(args.Holder());
+}
+
+void Recognizer::Restart(const FunctionCallbackInfo<Value>& args) {
+	Isolate* isolate = args.GetIsolate();
+	Recognizer* instance = node::ObjectWrap::Unwrap<Recognizer>(args.Holder());
+
+	if(!Ready(instance, isolate, true)) {
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	if(!instance->queue.Idle()) {
+		QueueControl(instance, isolate, JOB_RESTART);
+	} else {
+		RestartUtterance(instance, isolate);
+	}
+
+	args.GetReturnValue().Set(args.Holder());
+}
+
+void Recognizer::StartUtterance(Recognizer* instance, Isolate* isolate) {
+	if(instance->processing == false && !Governor::AdmitSession(&instance->qos)) {
+		Recognizer::Error(instance, isolate, "Overloaded, the session was refused");
+	} else if(instance->processing == false) {
+		// Apply keyword edits collected since the last utterance, copy the name
+		// since it belongs to the search that gets replaced
+		if(ActiveKeywords(instance) != NULL) {
+			string search = ps_get_search(instance->ps);
+			ApplyKeywords(instance, isolate, search.c_str());
+		}
+		instance->lastKeywordFrame = -1;
+
+		// Switch to the beams the pruning controller asked for while the last utterance ran,
+		// a replay switches to the recorded ones instead
+		if(instance->pruning.Pending() && instance->replaying == NULL) {
+			ApplyPruning(instance);
+		}
+
+		int result;
+		{
+			TraceSpan span("decode", "ps_start_utt", instance->traceId);
+			result = ps_start_utt(instance->ps);
+		}
+		if(result) {
+			Recognizer::Error(instance, isolate, "Failed to start PocketSphinx processing");
+		} else {
+			instance->processing = true;
+			instance->recorder.Control(SESSION_START);
+
+			// Trigger start callback
+			Emit(instance, isolate, "start", instance->startCallback, 0, NULL);
+		}
+	} else {
+		Recognizer::Error(instance, isolate, "PocketSphinx processing seems to run already");
+	}
+
+	// The start handler may have freed the Recognizer
+	if(instance->destructed)
+		return;
+
+	// Reset silence detection and the endpointer
+	instance->speechDetected = false;
+	instance->endpoint.Reset(instance->ps);
+}
+
+void Recognizer::StopUtterance(Recognizer* instance, Isolate* isolate) {
+	if(instance->processing == false)
+		return;
+
+	// Fetch hyp with isFinal flag
+	// ..and trigger hypFinal callback
+	if(Listening(instance, instance->hypFinalCallback)) {
+		int32 isFinal;
+		const char* hyp;
+		{
+			TraceSpan span("decode", "ps_get_hyp_final", instance->traceId);
+			hyp = ps_get_hyp_final(instance->ps, &isFinal);
+		}
+		EventArg argv[3];
+		argv[0].SetNull();
+		argv[1].SetString(hyp);
+		argv[2].SetNumber(isFinal);
+		Emit(instance, isolate, "hypFinal", instance->hypFinalCallback, 3, argv);
+
+		// The handler may have freed the decoder, nothing left to end
+		if(instance->destructed)
+			return;
+	}
+
+	// End the utterance
+	int result;
+	{
+		TraceSpan span("decode", "ps_end_utt", instance->traceId);
+		result = ps_end_utt(instance->ps);
+	}
+	if(result){
+		Recognizer::Error(instance, isolate, "Failed to end PocketSphinx processing");
+	} else {
+		instance->processing = false;
+		instance->recorder.Control(SESSION_STOP);
+		ReplayUtteranceEnded(instance);
+
+		// Run the second pass once per utterance in the background
+		if(instance->rescoreLm != NULL && Listening(instance, instance->hypRescoredCallback)) {
+			QueueRescore(instance);
+		}
+
+		// Trigger stop callback
+		Emit(instance, isolate, "stop", instance->stopCallback, 0, NULL);
+	}
+}
+
+void Recognizer::RestartUtterance(Recognizer* instance, Isolate* isolate) {
+	if(instance->processing == true) {
+		// Try stop processing
+		int result = ps_end_utt(instance->ps);
+		if(result) {
+			Recognizer::Error(instance, isolate, "Failed to restart PocketSphinx processing");
+			return;
+		}
+
+		instance->processing = false;
+		instance->recorder.Control(SESSION_RESTART);
+		ReplayUtteranceEnded(instance);
+
+		// Trigger stop callback
+		Emit(instance, isolate, "stop", instance->stopCallback, 0, NULL);
+		if(instance->destructed)
+			return;
+	}
+
+	// Start processing
+	StartUtterance(instance, isolate);
+}
+
+void Recognizer::QueueControl(Recognizer* instance, Isolate* isolate, int type) {
+	// Not limited, a full queue still has to be stoppable
+	AsyncData* data = instance->addon->jobPool.Acquire(false);
+	data->type = type;
+	data->job.after = ControlAfter;
+	instance->queue.Push(&data->job);
+}
+
+void Recognizer::ControlAfter(DecoderJob* job) {
+	AsyncData* data = reinterpret_cast<AsyncData*>(job->data);
+	Recognizer* instance = job->instance;
+	Isolate* isolate = instance->addon->isolate;
+	HandleScope scope(isolate);
+
+	if(data->type == JOB_FREE) {
+		FreeDecoder(instance);
+		instance->addon->jobPool.Release(data);
+		return;
+	}
+
+	// Queued before free(), nothing left to control, or behind a restore that failed and was reported
+	if(instance->destructed || instance->hibernated) {
+		instance->addon->jobPool.Release(data);
+		return;
+	}
+
+	if(data->type == JOB_START) {
+		StartUtterance(instance, isolate);
+	} else if(data->type == JOB_STOP) {
+		StopUtterance(instance, isolate);
+	} else if(data->type == JOB_RESTART) {
+		RestartUtterance(instance, isolate);
+	}
+
+	instance->addon->jobPool.Release(data);
+}
+
+void Recognizer::Write(const FunctionCallbackInfo<Value>& args) {
+	Isolate* isolate = args.GetIsolate();
+	Recognizer* instance = node::ObjectWrap::Unwrap<Recognizer>(args.Holder());
+
+	if(!Ready(instance, isolate, true)) {
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	if(!args.Length()) {
+		Recognizer::Error(instance, isolate, "Expected a data buffer to be provided");
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	Local<Object> buffer = args[0].As<Object>();
+
+	if(!node::Buffer::HasInstance(buffer)) {
+		Recognizer::Error(instance, isolate, "Expected data to be a buffer");
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	QueueWrite(instance, isolate, buffer);
+
+	args.GetReturnValue().Set(args.Holder());
+}
+
+void Recognizer::QueueWrite(Recognizer* instance, Isolate* isolate, Local<Object> buffer) {
+	AsyncData* data = instance->addon->jobPool.Acquire();
+	if(data == NULL) {
+		Recognizer::Error(instance, isolate, "Too many writes pending");
+		return;
+	}
+
+	// Ask the governor first, late or low priority audio is dropped under overload
+	size_t length = node::Buffer::Length(buffer) / sizeof(int16);
+	data->duration = AudioDuration(instance, length);
+	data->ahead = instance->qos.backlog;
+	if(!Governor::AdmitChunk(&instance->qos, data->duration * 1000)) {
+		EventArg argv[1];
+		argv[0].SetNumber(data->duration * 1000);
+		instance->addon->jobPool.Release(data);
+		Emit(instance, isolate, "dropped", instance->droppedCallback, 1, argv);
+		return;
+	}
+
+	// Pin the buffer until AsyncAfter, the worker reads straight from its memory
+	data->buffer.Reset(isolate, buffer);
+	data->data = (int16*) node::Buffer::Data(buffer);
+	data->length = length;
+	data->enqueued = uv_hrtime();
+	data->chunk = ++instance->traceChunks;
+	// The search can't change while writes are pending, so the worker doesn't need to look at the lists
+	data->spotting = ActiveKeywords(instance) != NULL;
+	data->job.work = AsyncWorker;
+	data->job.after = AsyncAfter;
+
+	// Runs once the jobs queued before are done, never next to another one
+	instance->queue.Push(&data->job);
+}
+
+void Recognizer::WriteSync(const FunctionCallbackInfo<Value>& args) {
+	Isolate* isolate = args.GetIsolate();
+	HandleScope scope(isolate);
+	Recognizer* instance = node::ObjectWrap::Unwrap<Recognizer>(args.Holder());
+
+	// Skip the buffer when not processing, unless queued jobs may still start an utterance
+	if(instance->processing == false && instance->queue.Idle()) {
+		return;
+	}
+
+	if(!Ready(instance, isolate, true)) {
+		return;
+	}
+
+	if(!args.Length()) {
+		Recognizer::Error(instance, isolate, "Expected data to be a buffer");
+		return;
+	}
+
+	Local<Object> buffer = args[0].As<Object>();
+
+	if(!node::Buffer::HasInstance(buffer)) {
+		Recognizer::Error(instance, isolate, "Expected data to be a buffer");
+		return;
+	}
+
+	// The decoder still works on earlier writes, this chunk has to wait for them
+	if(!instance->queue.Idle()) {
+		QueueWrite(instance, isolate, buffer);
+		args.GetReturnValue().Set(args.Holder());
+		return;
+	}
+
+	int16* data = (int16*) node::Buffer::Data(buffer);
+	size_t length = node::Buffer::Length(buffer) / sizeof(int16);
+
+	// Synchronous chunks never queue, but they load the process like written ones until they are decoded
+	double duration = AudioDuration(instance, length) * 1000;
+	if(!Governor::AdmitChunk(&instance->qos, duration)) {
+		EventArg argv[1];
+		argv[0].SetNumber(duration);
+		Emit(instance, isolate, "dropped", instance->droppedCallback, 1, argv);
+		return;
+	}
+
+	instance->recorder.Chunk(data, length);
+
+	// Decoded right here, the buffer stays alive for the duration of the call
+	AsyncData* chunk = instance->addon->jobPool.Acquire(false);
+	chunk->data = data;
+	chunk->length = length;
+	chunk->spotting = ActiveKeywords(instance) != NULL;
+	chunk->chunk = ++instance->traceChunks;
+	DecodeChunk(instance, chunk);
+	instance->pruning.Measure(chunk->decodeTime, duration / 1000);
+
+	instance->traceChunk = chunk->chunk;
+	if(chunk->hasException) {
+		Recognizer::Error(instance, isolate, chunk->exception);
+	} else {
+		DeliverChunk(instance, isolate, chunk);
+	}
+	instance->traceChunk = 0;
+	instance->addon->jobPool.Release(chunk);
+
+	// The object is alive until the call returned, free() in a handler doesn't unregister the stream
+	Governor::Done(&instance->qos, duration);
+
+	args.GetReturnValue().Set(args.Holder());
+}
+
+void Recognizer::DecodeChunk(Recognizer* instance, AsyncData* data) {
+	// No V8 access in here, write() calls it on a libuv pool thread
+	uint64_t start = uv_hrtime();
+	int processed = ps_process_raw(instance->ps, data->data, data->length, FALSE, FALSE);
+	uint64_t end = uv_hrtime();
+	data->decodeTime = (end - start) / 1e9;
+	Tracer::Record("decode", "ps_process_raw", instance->traceId, start, end, data->chunk);
+
+	if(processed < 0) {
+		data->hasException = true;
+		data->exception = "Failed to process audio data";
+		return;
+	}
+
+	int32 score;
+	const char* hyp;
+	{
+		TraceSpan span("decode", "ps_get_hyp", instance->traceId, data->chunk);
+		hyp = ps_get_hyp(instance->ps, &score);
+	}
+
+	// Copy the hypothesis, the decoder may overwrite it before the chunk is delivered
+	data->score = score;
+	data->hyp.assign(hyp ? hyp : "");
+
+	// The endpointer only needs these two numbers per chunk
+	data->frames = ps_get_n_frames(instance->ps);
+	data->inSpeech = ps_get_in_speech(instance->ps) == 1;
+
+	// Detections of the utterance so far, only the new ones are kept. The frame is only
+	// reset by start() on the loop thread, which never runs next to a chunk
+	if(data->spotting) {
+		for(ps_seg_t* seg = ps_seg_iter(instance->ps); seg != NULL; seg = ps_seg_next(seg)) {
+			int sf, ef;
+			ps_seg_frames(seg, &sf, &ef);
+			if(ef <= instance->lastKeywordFrame)
+				continue;
+			instance->lastKeywordFrame = ef;
+
+			KeywordDetection detection;
+			int32 ascr, lscr, lback;
+			detection.phrase.assign(ps_seg_word(seg));
+			detection.start = sf;
+			detection.end = ef;
+			detection.score = ps_seg_prob(seg, &ascr, &lscr, &lback);
+			data->keywords.push_back(detection);
+		}
+	}
+}
+
+void Recognizer::DeliverChunk(Recognizer* instance, Isolate* isolate, AsyncData* data) {
+	bool wasProcessing = instance->processing;
+
+	// Silence detection
+	if (instance->speechDetected == false && data->inSpeech) {
+		instance->speechDetected = true;
+		// Trigger speechDetected callback
+		Emit(instance, isolate, "speechDetected", instance->speechDetectedCallback, 0, NULL);
+	}
+	if (instance->speechDetected == true && !data->inSpeech) {
+		// Trigger silenceDetected callback
+		Emit(instance, isolate, "silenceDetected", instance->silenceDetectedCallback, 0, NULL);
+		// Stop decoding when sd is enabled, the endpointer decides on its own
+		if (instance->silenceDetection && !instance->endpoint.Enabled()) {
+			StopUtterance(instance, isolate);
+		}
+	}
+
+	// Handlers may have freed the Recognizer
+	if(instance->destructed)
+		return;
+
+	// Endpointing on frame counts
+	const char* reason;
+	double latency;
+	if (instance->endpoint.Enabled() && instance->processing && instance->endpoint.Update(data->frames, data->inSpeech, &reason, &latency)) {
+		EventArg endpointArgv[2];
+		endpointArgv[0].SetString(reason);
+		endpointArgv[1].SetNumber(latency);
+		Emit(instance, isolate, "endpoint", instance->endpointCallback, 2, endpointArgv);
+		// Triggers hypFinal right away
+		StopUtterance(instance, isolate);
+		if(instance->destructed)
+			return;
+	}
+
+	// Keyword lists report detections instead of the hypothesis
+	if(data->spotting) {
+		EmitKeywords(instance, isolate, data->keywords);
+	} else if(Listening(instance, instance->hypCallback)) {
+		EventArg argv[3];
+		argv[0].SetNull();
+		argv[1].SetString(data->hyp.c_str());
+		argv[2].SetNumber(data->score);
+		Emit(instance, isolate, "hyp", instance->hypCallback, 3, argv);
+	}
+
+	// Silence detection or the endpointer ended the utterance, which is the first point where the
+	// search can be rebuilt. Handlers ran first, so they could still ask for confidence() on its lattice
+	if(wasProcessing && !instance->processing && !instance->destructed && !instance->busy && instance->pruning.Pending()) {
+		ApplyPruning(instance);
+	}
+}
+
+void Recognizer::ApplyPruning(Recognizer* instance) {
+	if(instance->pruning.Apply(instance->ps)) {
+		instance->recorder.Pruning(instance->pruning.Beam(), instance->pruning.WordBeam(), instance->pruning.PhoneBeam(), instance->pruning.MaxHmmPerFrame());
+	}
+}
+
+void Recognizer::AsyncWorker(DecoderJob* job) {
+	AsyncData* data = reinterpret_cast<AsyncData*>(job->data);
+	Recognizer* instance = job->instance;
+
+	// A stop() queued before this chunk already ended the utterance, processing only
+	// changes on the loop thread between two jobs
+	if(!instance->processing) {
+		data->decoded = false;
+		return;
+	}
+
+	uint64_t start = uv_hrtime();
+	data->queueDelay = (start - data->enqueued) / 1e6;
+	Tracer::Record("queue", "uv_queue_work", instance->traceId, data->enqueued, start, data->chunk);
+
+	DecodeChunk(instance, data);
+}
+
+void Recognizer::AsyncAfter(DecoderJob* job) {
+	AsyncData* data = reinterpret_cast<AsyncData*>(job->data);
+	Recognizer* instance = job->instance;
+	Isolate* isolate = instance->addon->isolate;
+	HandleScope scope(isolate);
+
+	Governor::Done(&instance->qos, data->duration * 1000);
+
+	// Recorded in the order the decoder saw the chunks, with the time write() was called
+	instance->recorder.Chunk(data->data, data->length, data->enqueued);
+
+	if(!data->decoded) {
+		instance->addon->jobPool.Release(data);
+		return;
+	}
+
+	instance->pruning.Measure(data->decodeTime, data->duration);
+
+	// Events emitted for the chunk carry its number in the trace
+	instance->traceChunk = data->chunk;
+
+	// Waited longer than the audio written before it and the chunk itself last, the stream fell behind real time
+	if(data->queueDelay > data->ahead + data->duration * 1000) {
+		Governor::Late();
+		EventArg argv[1];
+		argv[0].SetNumber(data->queueDelay);
+		Emit(instance, isolate, "late", instance->lateCallback, 1, argv);
+	}
+
+	// A late handler may have freed the Recognizer
+	if(instance->destructed) {
+		instance->traceChunk = 0;
+		instance->addon->jobPool.Release(data);
+		return;
+	}
+
+	if(data->hasException) {
+		EventArg argv[1];
+		argv[0].SetError(data->exception);
+		Emit(instance, isolate, "hyp", instance->hypCallback, 1, argv);
+	} else {
+		// Same events as writeSync(), the decoder is idle until this returned
+		DeliverChunk(instance, isolate, data);
+	}
+
+	instance->traceChunk = 0;
+	instance->addon->jobPool.Release(data);
+}
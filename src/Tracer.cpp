@@ -0,0 +1,176 @@
+#include "Tracer.h"
+
+#include <stdio.h>
+#include <vector>
+
+using namespace std;
+
+typedef struct TraceEvent {
+	const char* category;
+	const char* name;
+	uint32_t id;
+	uint32_t chunk;
+	uint64_t start;
+	uint64_t end;
+} TraceEvent;
+
+// Written by its own thread only, Stop reads the first count events once recording stopped
+typedef struct TraceBuffer {
+	uint32_t tid;
+	uint32_t generation;
+	vector<TraceEvent> events;
+	atomic<size_t> count;
+	size_t dropped;
+} TraceBuffer;
+
+atomic<bool> Tracer::enabled(false);
+
+static uv_once_t once = UV_ONCE_INIT;
+static uv_mutex_t lock;
+static vector<TraceBuffer*> buffers;
+static atomic<uint32_t> generation(0);
+static atomic<uint32_t> nextId(0);
+static size_t capacity = 0;
+static uint64_t origin = 0;
+static string path;
+static thread_local TraceBuffer* local = NULL;
+
+static void InitOnce() {
+	uv_mutex_init(&lock);
+}
+
+// Writes a JSON string, escaped so that any name gives a valid file
+static void WriteString(FILE* file, const char* value) {
+	fputc('"', file);
+	for(const unsigned char* c = (const unsigned char*) value; *c != 0; c++) {
+		if(*c == '"' || *c == '\\') {
+			fputc('\\', file);
+			fputc(*c, file);
+		} else if(*c < 0x20) {
+			fprintf(file, "\\u%04x", *c);
+		} else {
+			fputc(*c, file);
+		}
+	}
+	fputc('"', file);
+}
+
+void Tracer::Start(const char* file, size_t bufferSize) {
+	uv_once(&once, InitOnce);
+	uv_mutex_lock(&lock);
+	path = file;
+	capacity = bufferSize;
+	origin = uv_hrtime();
+	// Buffers of the last trace are reset by their threads on the next span
+	generation++;
+	uv_mutex_unlock(&lock);
+	enabled.store(true);
+}
+
+bool Tracer::Stop() {
+	uv_once(&once, InitOnce);
+	if(!enabled.exchange(false))
+		return true;
+
+	uv_mutex_lock(&lock);
+	FILE* file = fopen(path.c_str(), "w");
+	if(file == NULL) {
+		uv_mutex_unlock(&lock);
+		return false;
+	}
+
+	uv_pid_t pid = uv_os_getpid();
+	fprintf(file, "{\"traceEvents\":[");
+	bool first = true;
+	for(size_t i = 0; i < buffers.size(); i++) {
+		TraceBuffer* buffer = buffers[i];
+		if(buffer->generation != generation)
+			continue;
+
+		size_t count = buffer->count.load(memory_order_acquire);
+		for(size_t j = 0; j < count; j++) {
+			const TraceEvent& event = buffer->events[j];
+			fprintf(file, "%s\n{\"name\":", first ? "" : ",");
+			WriteString(file, event.name);
+			fprintf(file, ",\"cat\":");
+			WriteString(file, event.category);
+			fprintf(file, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%u,\"args\":{\"recognizer\":%u",
+				(event.start - origin) / 1e3, (event.end - event.start) / 1e3, (int) pid, buffer->tid, event.id);
+			if(event.chunk != 0)
+				fprintf(file, ",\"chunk\":%u", event.chunk);
+			fprintf(file, "}}");
+			first = false;
+		}
+	}
+	fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+	bool written = fclose(file) == 0;
+
+	uv_mutex_unlock(&lock);
+	return written;
+}
+
+TraceStats Tracer::Stats() {
+	uv_once(&once, InitOnce);
+	uv_mutex_lock(&lock);
+	TraceStats stats;
+	stats.enabled = enabled.load();
+	stats.path = path;
+	stats.threads = 0;
+	stats.events = 0;
+	stats.dropped = 0;
+	for(size_t i = 0; i < buffers.size(); i++) {
+		if(buffers[i]->generation != generation)
+			continue;
+		stats.threads++;
+		stats.events += buffers[i]->count.load(memory_order_acquire);
+		stats.dropped += buffers[i]->dropped;
+	}
+	uv_mutex_unlock(&lock);
+	return stats;
+}
+
+uint32_t Tracer::NextId() {
+	return ++nextId;
+}
+
+void Tracer::Record(const char* category, const char* name, uint32_t id, uint64_t start, uint64_t end, uint32_t chunk) {
+	if(!Enabled())
+		return;
+
+	// First span of this thread, buffers live as long as the process since threads of the pool do too
+	if(local == NULL) {
+		uv_mutex_lock(&lock);
+		local = new TraceBuffer();
+		local->tid = buffers.size() + 1;
+		local->generation = 0;
+		local->count = 0;
+		local->dropped = 0;
+		buffers.push_back(local);
+		uv_mutex_unlock(&lock);
+	}
+
+	TraceBuffer* buffer = local;
+	if(buffer->generation != generation.load(memory_order_relaxed)) {
+		uv_mutex_lock(&lock);
+		buffer->events.resize(capacity);
+		buffer->count = 0;
+		buffer->dropped = 0;
+		buffer->generation = generation;
+		uv_mutex_unlock(&lock);
+	}
+
+	size_t count = buffer->count.load(memory_order_relaxed);
+	if(count >= buffer->events.size()) {
+		buffer->dropped++;
+		return;
+	}
+
+	TraceEvent& event = buffer->events[count];
+	event.category = category;
+	event.name = name;
+	event.id = id;
+	event.chunk = chunk;
+	event.start = start;
+	event.end = end;
+	buffer->count.store(count + 1, memory_order_release);
+}
@@ -0,0 +1,60 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <uv.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include <atomic>
+#include <string>
+
+typedef struct TraceStats {
+	bool enabled;
+	std::string path;
+	size_t threads;
+	size_t events;
+	size_t dropped;
+} TraceStats;
+
+// Records spans of the decode pipeline into per-thread buffers and writes them as Chrome trace event JSON,
+// which chrome://tracing and Perfetto load. While disabled a span costs one relaxed atomic load.
+class Tracer
+{
+public:
+	// Starts a new trace, every thread keeps up to bufferSize spans and drops the rest
+	static void Start(const char* path, size_t bufferSize);
+	// Stops recording and writes the spans of all threads to the path given to Start
+	static bool Stop();
+	static TraceStats Stats();
+
+	static bool Enabled() { return enabled.load(std::memory_order_relaxed); }
+	static uint32_t NextId();
+
+	// Category and name have to be string literals, only the pointers are stored. chunk numbers
+	// the written chunk of the Recognizer the span belongs to, 0 for spans outside of a chunk
+	static void Record(const char* category, const char* name, uint32_t id, uint64_t start, uint64_t end, uint32_t chunk = 0);
+
+private:
+	static std::atomic<bool> enabled;
+};
+
+// Records the lifetime of the enclosing scope as a span, in uv_hrtime nanoseconds
+class TraceSpan
+{
+public:
+	TraceSpan(const char* category, const char* name, uint32_t id, uint32_t chunk = 0)
+		: category(category), name(name), id(id), chunk(chunk), start(Tracer::Enabled() ? uv_hrtime() : 0) {}
+	~TraceSpan() {
+		if(start != 0)
+			Tracer::Record(category, name, id, start, uv_hrtime(), chunk);
+	}
+
+private:
+	const char* category;
+	const char* name;
+	uint32_t id;
+	uint32_t chunk;
+	uint64_t start;
+};
+
+#endif
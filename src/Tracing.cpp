@@ -0,0 +1,43 @@
+#include <node.h>
+#include "Recognizer.h"
+
+using namespace v8;
+using namespace std;
+
+void Recognizer::Trace(const FunctionCallbackInfo<Value>& args) {
+	Isolate* isolate = args.GetIsolate();
+	HandleScope scope(isolate);
+	Local<Context> context = isolate->GetCurrentContext();
+
+	if(args.Length() >= 1) {
+		if(args[0]->IsBoolean() && !args[0]->BooleanValue(isolate)) {
+			if(!Tracer::Stop()) {
+				isolate->ThrowException(Exception::Error(NewString(isolate, "Failed to write trace file")));
+				return;
+			}
+		} else if(args[0]->IsObject()) {
+			Local<Object> options = args[0].As<Object>();
+			Local<Value> path = options->Get(context, NewString(isolate, "path")).ToLocalChecked();
+			Local<Value> bufferSize = Default(options->Get(context, NewString(isolate, "bufferSize")).ToLocalChecked(), Integer::New(isolate, 65536));
+			if(!path->IsString() || !bufferSize->IsUint32() || bufferSize->Uint32Value(context).FromJust() == 0) {
+				isolate->ThrowException(Exception::TypeError(NewString(isolate, "Expected path to be a string and bufferSize to be a positive integer")));
+				return;
+			}
+			String::Utf8Value pathValue(isolate, path);
+			Tracer::Start(*pathValue, bufferSize->Uint32Value(context).FromJust());
+		} else {
+			isolate->ThrowException(Exception::TypeError(NewString(isolate, "Expected options to be an object or false")));
+			return;
+		}
+	}
+
+	TraceStats state = Tracer::Stats();
+	Local<Object> stats = Object::New(isolate);
+	stats->Set(context, NewString(isolate, "enabled"), Boolean::New(isolate, state.enabled)).Check();
+	stats->Set(context, NewString(isolate, "path"), NewString(isolate, state.path.c_str())).Check();
+	stats->Set(context, NewString(isolate, "threads"), Number::New(isolate, double(state.threads))).Check();
+	stats->Set(context, NewString(isolate, "events"), Number::New(isolate, double(state.events))).Check();
+	stats->Set(context, NewString(isolate, "dropped"), Number::New(isolate, double(state.dropped))).Check();
+
+	args.GetReturnValue().Set(stats);
+}
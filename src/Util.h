@@ -0,0 +1,18 @@
+#ifndef UTIL_H
+#define UTIL_H
+
+#include <v8.h>
+#include <node.h>
+
+inline v8::Local<v8::String> NewString(v8::Isolate* isolate, const char* value) {
+	return v8::String::NewFromUtf8(isolate, value, v8::NewStringType::kNormal).ToLocalChecked();
+}
+
+// Calls into JavaScript like a libuv callback would, so process.nextTick and promises
+// queued by the callback run and exceptions reach the uncaughtException handler
+inline void CallFunction(v8::Isolate* isolate, v8::Local<v8::Function> callback, int argc, v8::Local<v8::Value>* argv) {
+	v8::Local<v8::Object> receiver = isolate->GetCurrentContext()->Global();
+	node::MakeCallback(isolate, receiver, callback, argc, argv, node::async_context{0, 0});
+}
+
+#endif
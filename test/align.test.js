@@ -0,0 +1,83 @@
+var assert = require('assert'),
+	helpers = require('./helpers');
+
+function speech(words) {
+	var parts = [helpers.silence(0.3)];
+	for(var i = 0; i < words; i++) {
+		parts.push(helpers.noise(0.4), helpers.silence(0.6));
+	}
+	return helpers.concat(parts);
+}
+
+test('every pair gets the timings of its words in order', function(done) {
+	var ps = helpers.recognizer();
+	ps.on('error', done);
+	ps.align([
+		{ audio: speech(2), transcript: 'hello world' },
+		{ audio: speech(1), transcript: 'hello unknownword' },
+		{ audio: speech(3), transcript: 'one two three' }
+	], { concurrency: 2 }, function(err, results, stats) {
+		assert.ifError(err);
+		assert.strictEqual(stats.threads, 2);
+		assert.strictEqual(stats.frameRate, 100);
+
+		assert.strictEqual(results[0].error, null);
+		assert.deepStrictEqual(results[0].words, ['hello', 'world']);
+		assert.ok(results[0].start instanceof Int32Array);
+		assert.strictEqual(results[1].error, 'Transcript contains a word that is not in the dictionary');
+		assert.deepStrictEqual(results[2].words, ['one', 'two', 'three']);
+
+		[results[0], results[2]].forEach(function(result) {
+			for(var i = 0; i < result.words.length; i++) {
+				assert.ok(result.start[i] <= result.end[i]);
+				if(i > 0)
+					assert.ok(result.end[i - 1] < result.start[i]);
+			}
+		});
+		ps.free();
+		done();
+	});
+});
+
+test('words added at runtime are known to every thread', function(done) {
+	var ps = helpers.recognizer();
+	ps.on('error', done);
+	ps.addWords({ extra: 'EH K S T R AH' });
+	var pairs = [0, 1, 2].map(function() {
+		return { audio: speech(2), transcript: 'extra one' };
+	});
+	ps.align(pairs, { concurrency: 3 }, function(err, results, stats) {
+		assert.ifError(err);
+		assert.strictEqual(stats.threads, 3);
+		results.forEach(function(result) {
+			assert.strictEqual(result.error, null);
+		});
+		ps.free();
+		done();
+	});
+});
+
+test('the decoder of the recognizer keeps its search and last utterance', function(done) {
+	var ps = helpers.recognizer(),
+		final;
+	ps.silenceDetection(false);
+	ps.on('error', done);
+	ps.addKeyphraseSearch('wake', 'computer');
+	ps.search = 'wake';
+	ps.on('hypFinal', function(err, hyp) { final = hyp; });
+	ps.start();
+	ps.writeSync(speech(2));
+	ps.stop();
+
+	ps.align([{ audio: speech(1), transcript: 'go' }], function(err, results) {
+		assert.ifError(err);
+		assert.strictEqual(results[0].error, null);
+		assert.strictEqual(ps.search, 'wake');
+		ps.confidence(function(err, result) {
+			assert.ifError(err);
+			assert.strictEqual(result.hyp, final);
+			ps.free();
+			done();
+		});
+	});
+});
@@ -0,0 +1,134 @@
+var assert = require('assert'),
+	helpers = require('./helpers');
+
+function expectBusy(ps, call, done) {
+	ps.on('error', function(err) {
+		assert.ok(/^Recognizer is busy/.test(err.message), err.message);
+		done();
+	});
+	call();
+}
+
+test('searches are not changed while writes are pending', function(done) {
+	var ps = helpers.recognizer();
+	ps.start();
+	ps.write(helpers.noise(0.5));
+	expectBusy(ps, function() {
+		ps.addKeyphraseSearch('wake', 'computer');
+	}, function() {
+		ps.stop();
+		ps.on('stop', function() {
+			ps.free();
+			done();
+		});
+	});
+});
+
+test('every decoder call is refused while writes are pending', function(done) {
+	var ps = helpers.recognizer(),
+		errors = 0;
+	ps.on('error', function(err) {
+		assert.ok(/^Recognizer is busy/.test(err.message), err.message);
+		errors++;
+	});
+
+	ps.start();
+	ps.write(helpers.noise(0.5));
+	ps.search = 'ngram';
+	ps.addWords({ hello: 'HH AH L OW' });
+	ps.lookupWords(['hello']);
+	ps.setKeywords('wake', [{ phrase: 'computer' }]);
+	ps.pipeline({ lm: helpers.MODELS + '/en-us.lm.bin' });
+	ps.adaptivePruning({ target: 0.5 });
+	ps.reconfig({ '-lm': helpers.MODELS + '/en-us.lm.bin' }, function() {});
+	ps.decodeFile(helpers.tmp('busy.wav'), function() {
+		done(new Error('decodeFile ran next to the writes'));
+	});
+	assert.strictEqual(errors, 8);
+
+	ps.on('stop', function() {
+		ps.free();
+		done();
+	});
+	ps.stop();
+});
+
+test('methods are refused while a file is decoded', function(done) {
+	var ps = helpers.recognizer(),
+		file = helpers.wav(helpers.tmp('file.wav'), helpers.concat([helpers.silence(0.3), helpers.noise(0.5), helpers.silence(0.5)])),
+		errors = [];
+	ps.on('error', function(err) { errors.push(err.message); });
+
+	ps.decodeFile(file, function(err, result) {
+		assert.ifError(err);
+		assert.strictEqual(typeof result.hyp, 'string');
+		assert.deepStrictEqual(errors, ['Recognizer is busy', 'Recognizer is busy', 'Recognizer is busy']);
+		ps.free();
+		done();
+	});
+	ps.start();
+	ps.write(helpers.noise(0.1));
+	ps.free();
+});
+
+test('free waits for the chunk that is decoded', function(done) {
+	var ps = helpers.recognizer(),
+		hyps = 0;
+	ps.silenceDetection(false);
+	ps.on('hyp', function() { hyps++; });
+	ps.on('error', function(err) {
+		assert.strictEqual(err.message, 'Recognizer was freed');
+		// Chunks queued behind the freed one are skipped
+		setTimeout(function() {
+			assert.ok(hyps <= 1, hyps + ' hyps');
+			done();
+		}, 200);
+	});
+
+	ps.start();
+	for(var i = 0; i < 5; i++) {
+		ps.write(helpers.noise(0.5));
+	}
+	ps.free();
+	ps.start();
+});
+
+test('handlers of the last queued chunk may use the decoder', function(done) {
+	var ps = helpers.recognizer(),
+		stops = 0;
+	ps.on('error', done);
+	ps.on('stop', function() {
+		if(++stops === 1) {
+			// Called from the after callback of the chunk that ended the utterance
+			ps.reconfig({ '-lm': helpers.MODELS + '/en-us.lm.bin', '-samprate': helpers.SAMPLE_RATE, '-nfft': 512 }, function() {});
+			ps.start();
+		}
+	});
+	ps.on('start', function() {
+		if(stops === 1) {
+			ps.free();
+			done();
+		}
+	});
+
+	// Silence detection stops in the last chunk, nothing is queued behind it
+	ps.start();
+	ps.write(helpers.concat([helpers.silence(0.3), helpers.noise(0.5)]));
+	ps.write(helpers.silence(1));
+});
+
+test('free from a hypFinal handler of a queued stop', function(done) {
+	var ps = helpers.recognizer();
+	ps.on('error', done);
+	ps.on('hypFinal', function() {
+		ps.free();
+	});
+	ps.on('stop', function() {
+		done(new Error('stop after the decoder was freed'));
+	});
+
+	ps.start();
+	ps.write(helpers.noise(0.5));
+	ps.stop();
+	setTimeout(done, 100);
+});
@@ -0,0 +1,68 @@
+var assert = require('assert'),
+	PocketSphinx = require('../'),
+	helpers = require('./helpers');
+
+// Interleaves the same mono PCM into the given number of channels
+function interleave(pcm, channels) {
+	var samples = pcm.length / 2,
+		buffer = Buffer.alloc(pcm.length * channels);
+	for(var i = 0; i < samples; i++) {
+		for(var c = 0; c < channels; c++) {
+			buffer.writeInt16LE(pcm.readInt16LE(i * 2), (i * channels + c) * 2);
+		}
+	}
+	return buffer;
+}
+
+function hyps(result) {
+	return result.channels.map(function(channel) { return channel.hyp; });
+}
+
+test('every channel decodes with the search of the recognizer', function(done) {
+	var ps = helpers.recognizer();
+	ps.on('error', done);
+	ps.addKeyphraseSearch('wake', 'computer');
+	ps.search = 'wake';
+
+	ps.decodeChannels(interleave(helpers.utterance(), 3), 3, function(err, result) {
+		assert.ifError(err);
+		assert.deepStrictEqual(hyps(result), ['computer computer', 'computer computer', 'computer computer']);
+		assert.strictEqual(ps.search, 'wake');
+		ps.free();
+		done();
+	});
+});
+
+test('searches added later reach the decoders of earlier calls', function(done) {
+	var ps = helpers.recognizer(),
+		pcm = interleave(helpers.utterance(), 2);
+	ps.on('error', done);
+
+	ps.decodeChannels(pcm, 2, function(err, first) {
+		assert.ifError(err);
+		assert.strictEqual(first.channels[0].hyp, first.channels[1].hyp);
+
+		ps.setKeywords('hot', [{ phrase: 'hello' }, { phrase: 'world' }]);
+		ps.search = 'hot';
+		ps.decodeChannels(pcm, 2, function(err, second) {
+			assert.ifError(err);
+			assert.deepStrictEqual(hyps(second), ['hello world', 'hello world']);
+			ps.free();
+			done();
+		});
+	});
+});
+
+test('the decoder of the recognizer is not one of the channel decoders', function(done) {
+	var ps = helpers.recognizer(),
+		before = PocketSphinx.memory().decoders;
+	ps.on('error', done);
+
+	ps.decodeChannels(interleave(helpers.utterance(), 2), 2, function(err) {
+		assert.ifError(err);
+		assert.strictEqual(PocketSphinx.memory().decoders, before + 2);
+		ps.free();
+		assert.strictEqual(PocketSphinx.memory().decoders, before - 1);
+		done();
+	});
+});
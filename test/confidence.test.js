@@ -0,0 +1,68 @@
+var assert = require('assert'),
+	helpers = require('./helpers');
+
+test('confidence reports the last hypothesis with word posteriors', function(done) {
+	var ps = helpers.recognizer(),
+		final;
+	ps.silenceDetection(false);
+	ps.on('error', done);
+	ps.on('hypFinal', function(err, hyp) { final = hyp; });
+	ps.start();
+	ps.writeSync(helpers.utterance());
+	ps.stop();
+
+	ps.confidence(function(err, result) {
+		assert.ifError(err);
+		assert.strictEqual(result.hyp, final);
+		assert.ok(result.prob > 0 && result.prob <= 1, 'prob ' + result.prob);
+		assert.strictEqual(result.frameRate, 100);
+		var words = result.words.filter(function(word) { return word.word[0] !== '<'; });
+		assert.deepStrictEqual(words.map(function(word) { return word.word; }).join(' '), final);
+		words.forEach(function(word) {
+			assert.ok(word.start <= word.end);
+			assert.ok(word.prob > 0 && word.prob <= 1, 'prob ' + word.prob);
+		});
+		ps.free();
+		done();
+	});
+});
+
+test('the recognizer is busy until the confidence callback ran', function(done) {
+	var ps = helpers.recognizer(),
+		errors = [];
+	ps.silenceDetection(false);
+	ps.on('error', function(err) { errors.push(err.message); });
+	ps.start();
+	ps.writeSync(helpers.utterance());
+	ps.stop();
+
+	ps.confidence(function(err) {
+		assert.ifError(err);
+		assert.deepStrictEqual(errors, ['Recognizer is busy']);
+		ps.start();
+		ps.stop();
+		assert.strictEqual(errors.length, 1);
+		ps.free();
+		done();
+	});
+	ps.start();
+});
+
+test('confidence needs a stopped recognizer', function(done) {
+	var ps = helpers.recognizer(),
+		errors = [];
+	ps.on('error', function(err) { errors.push(err.message); });
+	ps.start();
+	ps.confidence(function() { done(new Error('called')); });
+	assert.deepStrictEqual(errors, ['Stop the recognizer before asking for confidence']);
+	ps.stop();
+
+	// Nothing was decoded
+	ps.confidence(function(err, result) {
+		assert.ifError(err);
+		assert.strictEqual(result.hyp, '');
+		assert.deepStrictEqual(result.words, []);
+		ps.free();
+		done();
+	});
+});
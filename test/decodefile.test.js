@@ -0,0 +1,67 @@
+var assert = require('assert'),
+	helpers = require('./helpers');
+
+// Bursts of speech with a pause after each
+function speech(bursts) {
+	var parts = [helpers.silence(0.3)];
+	for(var i = 0; i < bursts; i++) {
+		parts.push(helpers.noise(0.5), helpers.silence(0.7));
+	}
+	return helpers.concat(parts);
+}
+
+test('long files are decoded in utterances of bounded length', function(done) {
+	var ps = helpers.recognizer(),
+		short = helpers.wav(helpers.tmp('short.wav'), speech(3)),
+		long = helpers.wav(helpers.tmp('long.wav'), speech(60));
+	ps.on('error', done);
+
+	ps.decodeFile(short, function(err, first) {
+		assert.ifError(err);
+		ps.decodeFile(long, function(err, second) {
+			assert.ifError(err);
+			// Cut at every pause, the silence at the end is one more
+			assert.strictEqual(first.utterances, 4);
+			assert.strictEqual(second.utterances, 61);
+			// What the search holds does not grow with the file
+			assert.strictEqual(second.peakFrames, first.peakFrames);
+			assert.strictEqual(second.hyp.split(' ').length, 60);
+			ps.free();
+			done();
+		});
+	});
+});
+
+test('segments count their frames from the start of the file', function(done) {
+	var ps = helpers.recognizer(),
+		file = helpers.wav(helpers.tmp('segments.wav'), speech(4));
+	ps.on('error', done);
+
+	ps.decodeFile(file, function(err, result) {
+		assert.ifError(err);
+		var words = result.segments.filter(function(segment) { return segment.word[0] !== '<'; });
+		assert.strictEqual(words.length, 4);
+		for(var i = 1; i < words.length; i++) {
+			// One burst every 1.2 s
+			assert.ok(Math.abs(words[i].start - words[i - 1].start - 120) <= 5, words[i].start + ' after ' + words[i - 1].start);
+		}
+		assert.ok(words[3].end < result.audioDuration * result.frameRate / 1000);
+		ps.free();
+		done();
+	});
+});
+
+test('speech without a pause is split after maxUtterance', function(done) {
+	var ps = helpers.recognizer(),
+		file = helpers.wav(helpers.tmp('continuous.wav'), helpers.noise(5));
+	ps.on('error', done);
+
+	ps.decodeFile(file, { maxUtterance: 1000 }, function(err, result) {
+		assert.ifError(err);
+		assert.ok(result.utterances >= 5, 'utterances ' + result.utterances);
+		// Split at the first chunk boundary past the limit
+		assert.ok(result.peakFrames >= 100 && result.peakFrames < 130, 'peak ' + result.peakFrames);
+		ps.free();
+		done();
+	});
+});
@@ -0,0 +1,82 @@
+var assert = require('assert'),
+	helpers = require('./helpers');
+
+// Half a second of speech followed by two seconds of silence in 100 ms chunks
+function utterance() {
+	return helpers.chunks(helpers.concat([helpers.silence(0.3), helpers.noise(0.5), helpers.silence(2)]), 0.1);
+}
+
+function names(log) {
+	return log.map(function(event) { return event.name; });
+}
+
+test('the endpointer ends utterances fed by write', function(done) {
+	var ps = helpers.recognizer(),
+		log = helpers.events(ps, ['speechDetected', 'silenceDetected', 'endpoint', 'hypFinal']);
+	ps.endpointer({ trailingSilence: 300 });
+
+	ps.on('stop', function() {
+		assert.deepStrictEqual(names(log), ['speechDetected', 'silenceDetected', 'endpoint', 'hypFinal']);
+		var endpoint = log[2].args;
+		assert.strictEqual(endpoint[0], 'silence');
+		assert.ok(endpoint[1] >= 0 && endpoint[1] < 500, 'latency ' + endpoint[1]);
+		ps.free();
+		done();
+	});
+
+	ps.start();
+	utterance().forEach(function(chunk) { ps.write(chunk); });
+});
+
+test('writeSync and write end the utterance on the same chunk', function(done) {
+	var sync = helpers.recognizer(),
+		async = helpers.recognizer(),
+		syncLog = helpers.events(sync, ['endpoint']),
+		asyncLog = helpers.events(async, ['endpoint']);
+	sync.endpointer({ trailingSilence: 300 });
+	async.endpointer({ trailingSilence: 300 });
+
+	sync.start();
+	utterance().forEach(function(chunk) { sync.writeSync(chunk); });
+
+	async.on('stop', function() {
+		assert.strictEqual(syncLog.length, 1);
+		assert.deepStrictEqual(asyncLog[0].args, syncLog[0].args);
+		sync.free();
+		async.free();
+		done();
+	});
+	async.start();
+	utterance().forEach(function(chunk) { async.write(chunk); });
+});
+
+test('maxUtterance ends speech that never pauses', function(done) {
+	var ps = helpers.recognizer(),
+		log = helpers.events(ps, ['endpoint']);
+	ps.endpointer({ maxUtterance: 1000 });
+
+	ps.on('stop', function() {
+		assert.strictEqual(log.length, 1);
+		assert.strictEqual(log[0].args[0], 'maxUtterance');
+		assert.ok(log[0].args[1] < 100, 'latency ' + log[0].args[1]);
+		ps.free();
+		done();
+	});
+
+	ps.start();
+	helpers.chunks(helpers.noise(3), 0.1).forEach(function(chunk) { ps.write(chunk); });
+});
+
+test('silence detection stops utterances fed by write', function(done) {
+	var ps = helpers.recognizer(),
+		log = helpers.events(ps, ['speechDetected', 'silenceDetected']);
+
+	ps.on('stop', function() {
+		assert.deepStrictEqual(names(log), ['speechDetected', 'silenceDetected']);
+		ps.free();
+		done();
+	});
+
+	ps.start();
+	utterance().forEach(function(chunk) { ps.write(chunk); });
+});
@@ -0,0 +1,81 @@
+var assert = require('assert'),
+	path = require('path'),
+	Worker = require('worker_threads').Worker,
+	PocketSphinx = require('../'),
+	helpers = require('./helpers');
+
+test('errors are delivered through the event sink', function(done) {
+	var ps = helpers.recognizer(),
+		direct = 0;
+	ps.on('error', function() { direct++; });
+
+	PocketSphinx.eventSink(function(events) {
+		PocketSphinx.eventSink(null);
+		ps.free();
+
+		var errors = events.filter(function(event) { return event[1] === 'error'; });
+		assert.strictEqual(direct, 0);
+		assert.strictEqual(errors.length, 2);
+		assert.strictEqual(errors[0][0], ps);
+		assert.ok(errors[0][2] instanceof Error);
+		assert.strictEqual(errors[0][2].message, 'Expected data to be a buffer');
+		assert.strictEqual(errors[1][2].message, 'PocketSphinx processing seems to run already');
+		done();
+	});
+
+	ps.write('not a buffer');
+	ps.start();
+	ps.start();
+});
+
+test('errors go to the handler again after the sink was removed', function(done) {
+	var ps = helpers.recognizer();
+	PocketSphinx.eventSink(function() {});
+	PocketSphinx.eventSink(null);
+
+	ps.on('error', function(err) {
+		assert.strictEqual(err.message, 'Expected data to be a buffer');
+		ps.free();
+		done();
+	});
+	ps.write('not a buffer');
+});
+
+test('a worker with a pending sink exits cleanly', function(done) {
+	var source = [
+		'var PocketSphinx = require(' + JSON.stringify(path.resolve(__dirname, '..')) + ');',
+		'var helpers = require(' + JSON.stringify(path.join(__dirname, 'helpers')) + ');',
+		'PocketSphinx.eventSink(function() {});',
+		'var ps = helpers.recognizer();',
+		'ps.start();',
+		'ps.write(helpers.noise(0.5));',
+		'process.exit(0);'
+	].join('\n');
+
+	var worker = new Worker(source, { eval: true });
+	worker.on('error', done);
+	worker.on('exit', function(code) {
+		assert.strictEqual(code, 0);
+		done();
+	});
+});
+
+test('handlers get plain numbers with and without the sink', function(done) {
+	var ps = helpers.recognizer(),
+		direct;
+	ps.silenceDetection(false);
+	ps.on('hyp', function(err, hyp, score) { direct = score; });
+	ps.start();
+	ps.writeSync(helpers.noise(0.5));
+	assert.strictEqual(typeof direct, 'number');
+
+	PocketSphinx.eventSink(function(events) {
+		PocketSphinx.eventSink(null);
+		var hyps = events.filter(function(event) { return event[1] === 'hyp'; });
+		assert.strictEqual(typeof hyps[0][4], 'number');
+		ps.stop();
+		ps.free();
+		done();
+	});
+	ps.writeSync(helpers.noise(0.5));
+});
@@ -0,0 +1,99 @@
+var assert = require('assert'),
+	PocketSphinx = require('../'),
+	helpers = require('./helpers');
+
+test('a chunk longer than the deadline is decoded when nothing waits', function(done) {
+	var ps = helpers.recognizer(),
+		dropped = [],
+		hyps = 0;
+	PocketSphinx.governor({ maxBacklog: 60000 });
+	ps.qos({ deadline: 100 });
+	ps.on('dropped', function(duration) { dropped.push(+duration); });
+	ps.on('hyp', function() { hyps++; });
+	ps.on('stop', function() {
+		// The second chunk would have put 1000 ms in the queue
+		assert.deepStrictEqual(dropped, [500]);
+		assert.strictEqual(hyps, 1);
+		PocketSphinx.governor(false);
+		ps.free();
+		done();
+	});
+
+	ps.silenceDetection(false);
+	ps.start();
+	ps.write(helpers.noise(0.5));
+	ps.write(helpers.noise(0.5));
+	ps.stop();
+});
+
+test('recognizers are protected unless given a lower priority', function(done) {
+	var normal = helpers.recognizer(),
+		low = helpers.recognizer(),
+		errors = [];
+	PocketSphinx.governor({ maxBacklog: 1 });
+	low.qos({ priority: 0 });
+	normal.on('error', done);
+	low.on('error', function(err) { errors.push(err.message); });
+
+	normal.start();
+	normal.write(helpers.noise(0.5));
+	// The backlog of the first write overloads the process
+	normal.write(helpers.noise(0.1));
+	low.start();
+	assert.deepStrictEqual(errors, ['Overloaded, the session was refused']);
+
+	normal.on('stop', function() {
+		PocketSphinx.governor(false);
+		normal.free();
+		low.free();
+		done();
+	});
+	normal.stop();
+});
+
+test('writeSync counts toward the backlog while it decodes', function(done) {
+	var ps = helpers.recognizer(),
+		low = helpers.recognizer(),
+		backlog = -1,
+		errors = [];
+	PocketSphinx.governor({ maxBacklog: 100 });
+	low.qos({ priority: 0 });
+	low.on('error', function(err) { errors.push(err.message); });
+	ps.silenceDetection(false);
+	ps.on('hyp', function() {
+		backlog = PocketSphinx.governor().backlog;
+		low.start();
+	});
+
+	ps.start();
+	ps.writeSync(helpers.noise(0.5));
+	assert.strictEqual(backlog, 500);
+	assert.deepStrictEqual(errors, ['Overloaded, the session was refused']);
+	assert.strictEqual(PocketSphinx.governor().backlog, 0);
+
+	ps.stop();
+	PocketSphinx.governor(false);
+	ps.free();
+	low.free();
+	done();
+});
+
+test('free takes the stream out of the governor right away', function(done) {
+	var streams = PocketSphinx.governor().streams,
+		ps = helpers.recognizer();
+	PocketSphinx.governor({ maxBacklog: 60000 });
+	assert.strictEqual(PocketSphinx.governor().streams, streams + 1);
+
+	ps.start();
+	ps.write(helpers.noise(0.5));
+	// The write is decoded first, then the stream is gone without waiting for the wrapper to be collected
+	ps.free();
+	ps.free();
+	setTimeout(function() {
+		var stats = PocketSphinx.governor();
+		assert.strictEqual(stats.streams, streams);
+		assert.strictEqual(stats.backlog, 0);
+		PocketSphinx.governor(false);
+		done();
+	}, 100);
+});
@@ -0,0 +1,105 @@
+var fs = require('fs'),
+	os = require('os'),
+	path = require('path'),
+	PocketSphinx = require('../');
+
+var SAMPLE_RATE = 16000;
+
+var MODELS = PocketSphinx.Recognizer.modelDirectory + '/en-us';
+
+// Recognizer on the default models at 16 kHz, extra options override
+exports.recognizer = function(options) {
+	var config = {
+		'-lm': MODELS + '/en-us.lm.bin',
+		'-samprate': SAMPLE_RATE,
+		'-nfft': 512
+	};
+	for(var name in options || {}) {
+		config[name] = options[name];
+	}
+	return new PocketSphinx.Recognizer(config);
+};
+
+exports.SAMPLE_RATE = SAMPLE_RATE;
+exports.MODELS = MODELS;
+
+// 16 bit mono PCM of the given length in seconds
+exports.silence = function(seconds) {
+	return Buffer.alloc(Math.round(seconds * SAMPLE_RATE) * 2);
+};
+
+// Deterministic white noise, loud enough for the voice activity detector
+exports.noise = function(seconds, amplitude) {
+	var samples = Math.round(seconds * SAMPLE_RATE),
+		buffer = Buffer.alloc(samples * 2),
+		seed = 12345;
+	amplitude = amplitude || 8000;
+	for(var i = 0; i < samples; i++) {
+		seed = (seed * 1103515245 + 12345) & 0x7fffffff;
+		buffer.writeInt16LE(Math.round((seed / 0x7fffffff * 2 - 1) * amplitude), i * 2);
+	}
+	return buffer;
+};
+
+exports.concat = function(buffers) {
+	return Buffer.concat(buffers);
+};
+
+// Two bursts of speech with a pause between them and tail seconds of silence after them (Default: 0.5)
+exports.utterance = function(tail) {
+	return Buffer.concat([exports.silence(0.3), exports.noise(0.5), exports.silence(1), exports.noise(0.5), exports.silence(tail === undefined ? 0.5 : tail)]);
+};
+
+// Splits PCM into chunks of the given length in seconds, like a live stream delivers it
+exports.chunks = function(pcm, seconds) {
+	var size = Math.round(seconds * SAMPLE_RATE) * 2,
+		chunks = [];
+	for(var offset = 0; offset < pcm.length; offset += size) {
+		chunks.push(pcm.slice(offset, offset + size));
+	}
+	return chunks;
+};
+
+// Writes PCM samples as a 16 bit WAV file with the given number of channels
+exports.wav = function(file, pcm, channels) {
+	channels = channels || 1;
+	var header = Buffer.alloc(44);
+	header.write('RIFF', 0);
+	header.writeUInt32LE(36 + pcm.length, 4);
+	header.write('WAVE', 8);
+	header.write('fmt ', 12);
+	header.writeUInt32LE(16, 16);
+	header.writeUInt16LE(1, 20);
+	header.writeUInt16LE(channels, 22);
+	header.writeUInt32LE(SAMPLE_RATE, 24);
+	header.writeUInt32LE(SAMPLE_RATE * channels * 2, 28);
+	header.writeUInt16LE(channels * 2, 32);
+	header.writeUInt16LE(16, 34);
+	header.write('data', 36);
+	header.writeUInt32LE(pcm.length, 40);
+	fs.writeFileSync(file, Buffer.concat([header, pcm]));
+	return file;
+};
+
+// Path of a file in a directory that is removed when the tests finished
+var tmpDir = null;
+exports.tmp = function(name) {
+	if(tmpDir === null) {
+		tmpDir = fs.mkdtempSync(path.join(os.tmpdir(), 'pocketsphinx-test-'));
+		process.on('exit', function() {
+			fs.rmdirSync(tmpDir, { recursive: true });
+		});
+	}
+	return path.join(tmpDir, name);
+};
+
+// Collects the events of a Recognizer in the order they fired
+exports.events = function(ps, names) {
+	var log = [];
+	names.forEach(function(name) {
+		ps.on(name, function() {
+			log.push({ name: name, args: Array.prototype.slice.call(arguments) });
+		});
+	});
+	return log;
+};
@@ -0,0 +1,132 @@
+var assert = require('assert'),
+	fs = require('fs'),
+	helpers = require('./helpers');
+
+// Recognizer that hibernates right after it was configured
+function sleeping(setup, callback) {
+	var ps = helpers.recognizer();
+	ps.silenceDetection(false);
+	setup(ps);
+	ps.hibernate({ idle: 20 });
+	ps.on('hibernated', function() {
+		callback(ps);
+	});
+}
+
+test('reading the search does not wake the decoder', function(done) {
+	sleeping(function(ps) {
+		ps.addKeyphraseSearch('wake', 'computer');
+		ps.search = 'wake';
+	}, function(ps) {
+		assert.strictEqual(ps.search, 'wake');
+		assert.strictEqual(ps.hibernationStats().hibernated, true);
+		assert.strictEqual(ps.hibernationStats().restores, 0);
+		ps.free();
+		done();
+	});
+});
+
+test('start and write restore the decoder off the loop thread with its searches', function(done) {
+	sleeping(function(ps) {
+		ps.addWords({ extra: 'EH K S T R AH' });
+		ps.addKeyphraseSearch('wake', 'computer');
+		ps.search = 'wake';
+	}, function(ps) {
+		var log = helpers.events(ps, ['restored', 'start', 'hypFinal']);
+		ps.on('error', done);
+		ps.hibernate(false);
+
+		ps.start();
+		// Nothing was built yet, start waits behind the restore
+		assert.strictEqual(ps.hibernationStats().restoring, true);
+		assert.strictEqual(ps.search, 'wake');
+		ps.write(helpers.utterance());
+		ps.on('stop', function() {
+			assert.deepStrictEqual(log.map(function(event) { return event.name; }), ['restored', 'start', 'hypFinal']);
+			assert.strictEqual(log[2].args[1], 'computer computer');
+			assert.strictEqual(ps.hibernationStats().restores, 1);
+			assert.strictEqual(ps.search, 'wake');
+			ps.free();
+			done();
+		});
+		ps.stop();
+	});
+});
+
+test('a failed restore keeps the Recognizer hibernated', function(done) {
+	var model = helpers.tmp('restore.lm.bin');
+	fs.copyFileSync(helpers.MODELS + '/en-us.lm.bin', model);
+
+	sleeping(function(ps) {
+		ps.addNgramSearch('other', model);
+	}, function(ps) {
+		var errors = [],
+			started = 0;
+		ps.hibernate(false);
+		ps.on('start', function() { started++; });
+		ps.on('error', function(err) {
+			errors.push(err.message);
+			assert.strictEqual(ps.hibernationStats().hibernated, true);
+			assert.strictEqual(ps.hibernationStats().restores, 0);
+
+			// The start queued behind the restore is dropped, the next one tries again
+			setImmediate(function() {
+				assert.deepStrictEqual(errors, ['Failed to restore a search of the hibernated decoder']);
+				assert.strictEqual(started, 0);
+				fs.copyFileSync(helpers.MODELS + '/en-us.lm.bin', model);
+				ps.on('start', function() {
+					assert.strictEqual(ps.hibernationStats().restores, 1);
+					ps.stop();
+					ps.free();
+					done();
+				});
+				ps.start();
+			});
+		});
+
+		fs.unlinkSync(model);
+		ps.start();
+	});
+});
+
+test('calls that need the decoder right away restore it on the spot', function(done) {
+	sleeping(function(ps) {
+		ps.addKeyphraseSearch('wake', 'computer');
+	}, function(ps) {
+		var restored = 0;
+		ps.on('error', done);
+		ps.on('restored', function() { restored++; });
+
+		ps.search = 'wake';
+		assert.strictEqual(restored, 1);
+		assert.strictEqual(ps.hibernationStats().hibernated, false);
+		assert.strictEqual(ps.search, 'wake');
+		ps.free();
+		done();
+	});
+});
+
+test('queued work keeps the decoder awake until it is done', function(done) {
+	var file = helpers.tmp('idle.bin'),
+		ps = helpers.recognizer(),
+		hibernated = false;
+	ps.on('error', done);
+	ps.record(file);
+	ps.start();
+	setTimeout(function() {
+		ps.stop();
+		ps.record(false);
+
+		// The replay runs on the decoder through the job queue of the Recognizer
+		ps.hibernate({ idle: 20 });
+		ps.on('hibernated', function() { hibernated = true; });
+		ps.replay(file, { realtime: true }, function(err) {
+			assert.ifError(err);
+			assert.strictEqual(hibernated, false);
+			ps.on('hibernated', function() {
+				ps.free();
+				done();
+			});
+		});
+	}, 300);
+});
@@ -0,0 +1,64 @@
+// Runs every *.test.js file in this directory, a test is a function that calls done(err) when finished
+var fs = require('fs'),
+	path = require('path');
+
+var TIMEOUT = 30000;
+
+var tests = [];
+global.test = function(name, fn) {
+	tests.push({ name: name, fn: fn });
+};
+
+var files = fs.readdirSync(__dirname).filter(function(file) {
+	return /\.test\.js$/.test(file);
+}).sort();
+
+var filter = process.argv[2];
+files.forEach(function(file) {
+	if(!filter || file.indexOf(filter) !== -1) {
+		var before = tests.length;
+		require(path.join(__dirname, file));
+		for(var i = before; i < tests.length; i++) {
+			tests[i].name = file.replace(/\.test\.js$/, '') + ': ' + tests[i].name;
+		}
+	}
+});
+
+var failed = 0, index = 0;
+
+function next() {
+	if(index >= tests.length) {
+		console.log('\n%d of %d tests passed', tests.length - failed, tests.length);
+		process.exit(failed ? 1 : 0);
+	}
+
+	var current = tests[index++],
+		finished = false;
+
+	function done(err) {
+		if(finished) return;
+		finished = true;
+		clearTimeout(timer);
+		process.removeListener('uncaughtException', done);
+		if(err) {
+			failed++;
+			console.log('not ok - %s\n  %s', current.name, (err && err.stack) || err);
+		} else {
+			console.log('ok - %s', current.name);
+		}
+		setImmediate(next);
+	}
+
+	var timer = setTimeout(function() {
+		done(new Error('Timed out after ' + TIMEOUT + ' ms'));
+	}, TIMEOUT);
+	process.on('uncaughtException', done);
+
+	try {
+		current.fn(done);
+	} catch(err) {
+		done(err);
+	}
+}
+
+next();
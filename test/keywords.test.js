@@ -0,0 +1,118 @@
+var assert = require('assert'),
+	helpers = require('./helpers');
+
+var PHRASES = [{ phrase: 'hello' }, { phrase: 'world', threshold: 1e-20 }];
+
+function spotter() {
+	var ps = helpers.recognizer();
+	ps.silenceDetection(false);
+	ps.setKeywords('hot', PHRASES);
+	ps.search = 'hot';
+	return ps;
+}
+
+// Phrase, start and end of every keyword event
+function detections(ps) {
+	var log = [];
+	ps.on('keyword', function(err, phrase, start, end) {
+		assert.strictEqual(err, null);
+		log.push([phrase, +start, +end]);
+	});
+	return log;
+}
+
+test('write reports the same keywords as writeSync', function(done) {
+	var sync = spotter(),
+		expected = detections(sync);
+	sync.start();
+	sync.writeSync(helpers.utterance());
+	sync.stop();
+	sync.free();
+	assert.strictEqual(expected.length, 2);
+
+	var ps = spotter(),
+		log = detections(ps),
+		hyps = 0;
+	ps.on('hyp', function() { hyps++; });
+	ps.on('stop', function() {
+		assert.deepStrictEqual(log, expected);
+		assert.strictEqual(hyps, 0);
+		ps.free();
+		done();
+	});
+
+	ps.start();
+	helpers.chunks(helpers.utterance(), 0.1).forEach(function(chunk) {
+		ps.write(chunk);
+	});
+	ps.stop();
+});
+
+test('keyword lists are rebuilt after reconfig', function(done) {
+	var ps = spotter(),
+		log = detections(ps);
+	ps.on('error', done);
+
+	ps.reconfig({ '-lm': helpers.MODELS + '/en-us.lm.bin', '-samprate': helpers.SAMPLE_RATE, '-nfft': 512 }, function() {});
+	ps.search = 'hot';
+	assert.strictEqual(ps.search, 'hot');
+
+	ps.start();
+	ps.writeSync(helpers.utterance());
+	ps.stop();
+	assert.deepStrictEqual(log.map(function(entry) { return entry[0]; }), ['hello', 'world']);
+	ps.free();
+	done();
+});
+
+test('detections are reported once per utterance', function(done) {
+	var ps = spotter(),
+		log = detections(ps);
+
+	ps.start();
+	helpers.chunks(helpers.utterance(), 0.05).forEach(function(chunk) {
+		ps.writeSync(chunk);
+	});
+	ps.stop();
+	assert.strictEqual(log.length, 2);
+
+	// The next utterance starts counting again
+	ps.start();
+	ps.writeSync(helpers.utterance());
+	ps.stop();
+	assert.strictEqual(log.length, 4);
+	ps.free();
+	done();
+});
+
+test('phrases a keyword file cannot hold are refused', function(done) {
+	var ps = spotter(),
+		errors = [];
+	ps.on('error', function(err) { errors.push(err.message); });
+
+	ps.addKeyword('hot', 'hello /1e-50/');
+	ps.addKeyword('hot', 'hello\nworld');
+	ps.addKeyword('hot', ' \t ');
+	ps.addKeyword('hot', 'go', 0);
+	ps.setKeywords('hot', [{ phrase: 'one' }, { phrase: 'two/' }]);
+	assert.deepStrictEqual(errors, [
+		'Expected phrase to be words without \'/\' or line breaks',
+		'Expected phrase to be words without \'/\' or line breaks',
+		'Expected phrase to be words without \'/\' or line breaks',
+		'Expected threshold to be a positive number',
+		'Expected phrase to be words without \'/\' or line breaks'
+	]);
+
+	// Nothing of the refused calls reached the list, extra spaces are dropped
+	ps.addKeyword('hot', '  hello   world ');
+	assert.strictEqual(ps.removeKeyword('hot', 'hello world'), true);
+	assert.strictEqual(ps.removeKeyword('hot', 'one'), false);
+	var log = detections(ps);
+	ps.start();
+	ps.writeSync(helpers.utterance());
+	ps.stop();
+	assert.deepStrictEqual(log.map(function(entry) { return entry[0]; }), ['hello', 'world']);
+	assert.deepStrictEqual(errors.length, 5);
+	ps.free();
+	done();
+});
@@ -0,0 +1,85 @@
+var assert = require('assert'),
+	path = require('path'),
+	v8 = require('v8'),
+	vm = require('vm'),
+	Worker = require('worker_threads').Worker,
+	PocketSphinx = require('../'),
+	helpers = require('./helpers');
+
+v8.setFlagsFromString('--expose-gc');
+var gc = vm.runInNewContext('gc');
+
+test('every decoder is counted until it is freed', function(done) {
+	var before = PocketSphinx.memory(),
+		ps = helpers.recognizer(),
+		one = PocketSphinx.memory();
+	assert.strictEqual(one.decoders, before.decoders + 1);
+	assert.ok(one.bytes > before.bytes);
+
+	ps.free();
+	assert.deepStrictEqual(PocketSphinx.memory(), before);
+	done();
+});
+
+test('abandoned recognizers release their decoders when collected', function(done) {
+	var before = PocketSphinx.memory().decoders;
+	(function() {
+		for(var i = 0; i < 3; i++) {
+			helpers.recognizer();
+		}
+	})();
+	assert.strictEqual(PocketSphinx.memory().decoders, before + 3);
+
+	// Weak callbacks run after the collection
+	gc();
+	setImmediate(function() {
+		gc();
+		assert.strictEqual(PocketSphinx.memory().decoders, before);
+		done();
+	});
+});
+
+test('a pending job keeps the recognizer alive', function(done) {
+	var before = PocketSphinx.memory().decoders;
+	(function() {
+		var ps = helpers.recognizer();
+		ps.start();
+		ps.writeSync(helpers.noise(0.5));
+		ps.stop();
+		ps.confidence(function(err, result) {
+			assert.ifError(err);
+			assert.strictEqual(typeof result.prob, 'number');
+			setImmediate(function() {
+				gc();
+				setImmediate(function() {
+					assert.strictEqual(PocketSphinx.memory().decoders, before);
+					done();
+				});
+			});
+		});
+	})();
+	gc();
+	assert.strictEqual(PocketSphinx.memory().decoders, before + 1);
+});
+
+test('a worker exits cleanly with hibernation timers and running jobs', function(done) {
+	var source = [
+		'var PocketSphinx = require(' + JSON.stringify(path.resolve(__dirname, '..')) + ');',
+		'var helpers = require(' + JSON.stringify(path.join(__dirname, 'helpers')) + ');',
+		'var ps = helpers.recognizer();',
+		'ps.hibernate({ idle: 60000 });',
+		'ps.start();',
+		'ps.writeSync(helpers.noise(0.5));',
+		'ps.stop();',
+		'ps.confidence(function() {});',
+		'helpers.recognizer().hibernate({ idle: 60000 });',
+		'process.exit(0);'
+	].join('\n');
+
+	var worker = new Worker(source, { eval: true });
+	worker.on('error', done);
+	worker.on('exit', function(code) {
+		assert.strictEqual(code, 0);
+		done();
+	});
+});
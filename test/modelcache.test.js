@@ -0,0 +1,124 @@
+var assert = require('assert'),
+	fs = require('fs'),
+	path = require('path'),
+	Worker = require('worker_threads').Worker,
+	PocketSphinx = require('../'),
+	helpers = require('./helpers');
+
+// Text model and empty cache directory of their own for every test
+function setup(name) {
+	var dir = helpers.tmp(name);
+	fs.mkdirSync(dir);
+	var lm = path.join(dir, 'model.lm');
+	fs.copyFileSync(helpers.MODELS + '/en-us.lm', lm);
+	fs.mkdirSync(path.join(dir, 'cache'));
+	PocketSphinx.modelCache(path.join(dir, 'cache'));
+	return lm;
+}
+
+// Polls until the background conversion was counted
+function converted(count, callback) {
+	if(PocketSphinx.modelCache().conversions >= count)
+		return callback();
+	setTimeout(converted, 10, count, callback);
+}
+
+test('prepareModel converts the text model on a worker thread', function(done) {
+	var lm = setup('prepare');
+	var stats = PocketSphinx.modelCache();
+	PocketSphinx.prepareModel(lm, function(err, binary) {
+		assert.ifError(err);
+		assert.ok(/\.lm\.bin$/.test(binary), binary);
+		assert.ok(fs.existsSync(binary));
+		assert.strictEqual(PocketSphinx.modelCache().conversions, stats.conversions + 1);
+
+		// The second request is answered from the resolved file
+		PocketSphinx.prepareModel(lm, function(err, again) {
+			assert.ifError(err);
+			assert.strictEqual(again, binary);
+			assert.strictEqual(PocketSphinx.modelCache().conversions, stats.conversions + 1);
+			PocketSphinx.modelCache(null);
+			done();
+		});
+	});
+});
+
+test('a new recognizer reads the text model and converts it in the background', function(done) {
+	var lm = setup('background');
+	var before = PocketSphinx.modelCache();
+	helpers.recognizer({ '-lm': lm }).free();
+
+	converted(before.conversions + 1, function() {
+		var hits = PocketSphinx.modelCache().hits;
+		var next = helpers.recognizer({ '-lm': lm });
+		assert.strictEqual(PocketSphinx.modelCache().hits, hits + 1);
+		next.free();
+		PocketSphinx.modelCache(null);
+		done();
+	});
+});
+
+test('a recognizer created while the conversion runs does not queue it again', function(done) {
+	var lm = setup('burst');
+	var before = PocketSphinx.modelCache().conversions;
+	for(var i = 0; i < 4; i++) {
+		helpers.recognizer({ '-lm': lm }).free();
+	}
+	converted(before + 1, function() {
+		setTimeout(function() {
+			assert.strictEqual(PocketSphinx.modelCache().conversions, before + 1);
+			PocketSphinx.modelCache(null);
+			done();
+		}, 50);
+	});
+});
+
+test('copies of a model converted at the same time share the cache file', function(done) {
+	var lm = setup('copies'),
+		copy = path.join(path.dirname(lm), 'copy.lm'),
+		cache = path.join(path.dirname(lm), 'cache'),
+		results = [];
+	fs.copyFileSync(lm, copy);
+
+	function prepared(err, binary) {
+		assert.ifError(err);
+		results.push(binary);
+		if(results.length < 2)
+			return;
+		// Same content, same target, and no temporary file left behind
+		assert.strictEqual(results[0], results[1]);
+		assert.deepStrictEqual(fs.readdirSync(cache), [path.basename(results[0])]);
+		PocketSphinx.modelCache(null);
+		done();
+	}
+	PocketSphinx.prepareModel(lm, prepared);
+	PocketSphinx.prepareModel(copy, prepared);
+});
+
+test('prepareModel reports files that can not be converted', function(done) {
+	setup('missing');
+	PocketSphinx.prepareModel(helpers.tmp('missing/none.lm'), function(err) {
+		assert.ok(err instanceof Error);
+		assert.strictEqual(err.message, 'Failed to convert language model');
+		PocketSphinx.modelCache(null);
+		done();
+	});
+});
+
+test('a worker exits cleanly while a model is converted', function(done) {
+	var lm = setup('worker');
+	PocketSphinx.modelCache(null);
+	var source = [
+		'var PocketSphinx = require(' + JSON.stringify(path.resolve(__dirname, '..')) + ');',
+		'PocketSphinx.modelCache(' + JSON.stringify(path.join(path.dirname(lm), 'cache')) + ');',
+		'PocketSphinx.prepareModel(' + JSON.stringify(lm) + ', function() {});',
+		'process.exit(0);'
+	].join('\n');
+
+	var worker = new Worker(source, { eval: true });
+	worker.on('error', done);
+	worker.on('exit', function(code) {
+		assert.strictEqual(code, 0);
+		done();
+	});
+});
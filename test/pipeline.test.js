@@ -0,0 +1,95 @@
+var assert = require('assert'),
+	helpers = require('./helpers');
+
+var LM = helpers.MODELS + '/en-us.lm.bin';
+
+test('the second pass rescores the stopped utterance', function(done) {
+	var ps = helpers.recognizer(),
+		final = null;
+	ps.pipeline({ lm: LM });
+	ps.on('hypFinal', function(err, hyp) { final = hyp; });
+	ps.on('hypRescored', function(err, hyp) {
+		assert.ifError(err);
+		assert.strictEqual(typeof hyp, 'string');
+		assert.strictEqual(hyp, final);
+		ps.free();
+		done();
+	});
+
+	ps.start();
+	ps.writeSync(helpers.utterance(0.3));
+	ps.stop();
+});
+
+test('the next utterance starts while the second pass runs', function(done) {
+	var ps = helpers.recognizer(),
+		rescored = 0;
+	ps.pipeline({ lm: LM });
+	ps.on('error', done);
+	ps.on('hypRescored', function(err, hyp) {
+		assert.ifError(err);
+		assert.strictEqual(typeof hyp, 'string');
+		if(++rescored === 3) {
+			ps.free();
+			done();
+		}
+	});
+
+	// The decoder's dictionary and search change under the queued lattices
+	for(var i = 0; i < 3; i++) {
+		ps.start();
+		ps.writeSync(helpers.utterance(0.3));
+		ps.stop();
+		ps.addWords({ extra: 'EH K S T R AH' });
+		ps.addKeyphraseSearch('wake' + i, 'computer');
+		ps.search = 'ngram';
+	}
+});
+
+test('overlapping second passes of several recognizers finish', function(done) {
+	var count = 4,
+		rescored = 0;
+	for(var i = 0; i < count; i++) {
+		(function(ps) {
+			ps.pipeline({ lm: LM, instances: 2 });
+			ps.on('hypRescored', function(err, hyp) {
+				assert.ifError(err);
+				assert.strictEqual(typeof hyp, 'string');
+				ps.free();
+				if(++rescored === count)
+					done();
+			});
+			ps.start();
+			ps.writeSync(helpers.utterance(0.3));
+			ps.stop();
+		})(helpers.recognizer());
+	}
+});
+
+test('confidence does not wait for the second pass', function(done) {
+	var ps = helpers.recognizer();
+	ps.pipeline({ lm: LM });
+	ps.on('error', done);
+
+	ps.start();
+	ps.writeSync(helpers.utterance(0.3));
+	ps.stop();
+	ps.confidence(function(err, result) {
+		assert.ifError(err);
+		assert.strictEqual(typeof result.prob, 'number');
+		ps.free();
+		done();
+	});
+});
+
+test('instances must be a positive integer', function(done) {
+	var ps = helpers.recognizer(),
+		errors = [];
+	ps.on('error', function(err) { errors.push(err); });
+	ps.pipeline({ lm: LM, instances: 0 });
+	ps.pipeline({ lm: LM, instances: 'two' });
+	assert.strictEqual(errors.length, 2);
+	errors.forEach(function(err) { assert.ok(err instanceof TypeError, err.message); });
+	ps.free();
+	done();
+});
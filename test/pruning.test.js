@@ -0,0 +1,97 @@
+var assert = require('assert'),
+	helpers = require('./helpers');
+
+function utterance() {
+	return helpers.chunks(helpers.concat([helpers.silence(0.3), helpers.noise(0.5), helpers.silence(2)]), 0.1);
+}
+
+// A target no decoder meets, every chunk asks for tighter beams
+function pruned() {
+	var ps = helpers.recognizer();
+	ps.adaptivePruning({ target: 1e-9, maxLevel: 2 });
+	return ps;
+}
+
+test('the endpointer applies the new level without waiting for start', function(done) {
+	var ps = pruned();
+	ps.endpointer({ trailingSilence: 300 });
+	ps.on('error', done);
+
+	ps.start();
+	utterance().forEach(function(chunk) { ps.writeSync(chunk); });
+
+	var stats = ps.pruningStats();
+	assert.strictEqual(stats.level, 2);
+	assert.strictEqual(stats.pending, false);
+	assert.strictEqual(stats.adjustments, 1);
+	ps.free();
+	done();
+});
+
+test('the configured beams stay in the decoder configuration', function(done) {
+	var ps = pruned(),
+		base = ps.pruningStats().beam;
+	ps.on('error', done);
+
+	ps.start();
+	utterance().forEach(function(chunk) { ps.writeSync(chunk); });
+	ps.stop();
+	ps.start();
+	ps.stop();
+	assert.ok(ps.pruningStats().beam > base, 'beam ' + ps.pruningStats().beam);
+
+	// Enabling again starts from the configured beams, not from the applied ones
+	ps.adaptivePruning(false);
+	ps.adaptivePruning({ target: 0.5 });
+	assert.strictEqual(ps.pruningStats().beam, base);
+	assert.strictEqual(ps.pruningStats().level, 0);
+	ps.free();
+	done();
+});
+
+test('a new level waits while confidence reads the lattice', function(done) {
+	var ps = pruned(),
+		stops = 0;
+	ps.endpointer({ trailingSilence: 300 });
+	ps.on('error', done);
+	ps.on('stop', function() {
+		if(++stops > 1)
+			return;
+		ps.confidence(function(err, result) {
+			assert.ifError(err);
+			assert.strictEqual(typeof result.prob, 'number');
+			assert.strictEqual(ps.pruningStats().pending, true);
+
+			// Applied when the next utterance starts
+			ps.start();
+			assert.strictEqual(ps.pruningStats().pending, false);
+			ps.stop();
+			ps.free();
+			done();
+		});
+	});
+
+	ps.start();
+	utterance().forEach(function(chunk) { ps.writeSync(chunk); });
+});
+
+test('a switched search gets the beams of the level', function(done) {
+	var ps = pruned();
+	ps.on('error', done);
+
+	ps.start();
+	utterance().forEach(function(chunk) { ps.writeSync(chunk); });
+	ps.stop();
+	ps.start();
+	ps.stop();
+	assert.strictEqual(ps.pruningStats().pending, false);
+
+	ps.addNgramSearch('other', helpers.MODELS + '/en-us.lm.bin');
+	ps.search = 'other';
+	assert.strictEqual(ps.pruningStats().pending, true);
+	ps.start();
+	assert.strictEqual(ps.pruningStats().pending, false);
+	ps.stop();
+	ps.free();
+	done();
+});
@@ -0,0 +1,170 @@
+var assert = require('assert'),
+	helpers = require('./helpers');
+
+// Decodes one utterance and returns its final hypothesis
+function decode(ps) {
+	var final;
+	ps.on('hypFinal', function(err, hyp) { final = hyp; });
+	ps.start();
+	ps.writeSync(helpers.utterance());
+	ps.stop();
+	return final;
+}
+
+test('searches added before recording exist in the replay decoder', function(done) {
+	var file = helpers.tmp('before.bin'),
+		ps = helpers.recognizer();
+	ps.silenceDetection(false);
+	ps.addKeyphraseSearch('wake', 'computer');
+	ps.search = 'wake';
+	ps.record(file);
+	var expected = decode(ps);
+	ps.record(false);
+	ps.free();
+
+	// A fresh Recognizer knows nothing about the search
+	var other = helpers.recognizer();
+	other.on('error', done);
+	other.replay(file, function(err, result) {
+		assert.ifError(err);
+		assert.deepStrictEqual(result.hyps, [expected]);
+		// The Recognizer runs the recorded session, search included
+		assert.strictEqual(other.search, 'wake');
+		other.free();
+		done();
+	});
+});
+
+test('searches, words and keyword lists added while recording are replayed', function(done) {
+	var file = helpers.tmp('during.bin'),
+		ps = helpers.recognizer(),
+		expected = [];
+	ps.silenceDetection(false);
+	ps.record(file);
+	ps.addWords({ extra: 'EH K S T R AH' });
+	ps.addNgramSearch('other', helpers.MODELS + '/en-us.lm.bin');
+	ps.search = 'other';
+	expected.push(decode(ps));
+	ps.setKeywords('hot', [{ phrase: 'hello' }, { phrase: 'world' }]);
+	ps.search = 'hot';
+	expected.push(decode(ps));
+	ps.record(false);
+	ps.free();
+
+	var other = helpers.recognizer();
+	other.on('error', done);
+	other.replay(file, function(err, result) {
+		assert.ifError(err);
+		assert.deepStrictEqual(result.hyps, expected);
+		other.free();
+		done();
+	});
+});
+
+test('the replay delivers the events of the recorded session', function(done) {
+	var file = helpers.tmp('events.bin'),
+		ps = helpers.recognizer();
+	ps.record(file);
+	ps.start();
+	helpers.chunks(helpers.utterance(), 0.1).forEach(function(chunk) { ps.writeSync(chunk); });
+	ps.stop();
+	ps.record(false);
+	ps.free();
+
+	var other = helpers.recognizer(),
+		log = helpers.events(other, ['start', 'speechDetected', 'hypFinal', 'stop']);
+	other.on('error', done);
+	other.replay(file, function(err, result) {
+		assert.ifError(err);
+		var names = log.map(function(event) { return event.name; });
+		assert.strictEqual(names[0], 'start');
+		assert.strictEqual(names[names.length - 1], 'stop');
+		assert.ok(names.indexOf('speechDetected') > 0, names.join());
+		assert.strictEqual(log.filter(function(event) { return event.name === 'hypFinal'; }).length, result.hyps.length);
+		other.free();
+		done();
+	});
+});
+
+test('the Recognizer is busy while it replays', function(done) {
+	var file = helpers.tmp('busy.bin'),
+		ps = helpers.recognizer(),
+		errors = [];
+	ps.silenceDetection(false);
+	ps.record(file);
+	decode(ps);
+	ps.record(false);
+
+	ps.on('error', function(err) { errors.push(err.message); });
+	ps.replay(file, function(err, result) {
+		assert.ifError(err);
+		assert.strictEqual(result.hyps.length, 1);
+		assert.deepStrictEqual(errors, ['Recognizer is busy', 'Recognizer is busy']);
+		ps.start();
+		ps.stop();
+		assert.strictEqual(errors.length, 2);
+		ps.free();
+		done();
+	});
+	ps.start();
+	ps.search = '_default';
+});
+
+test('refuses to replay into a started Recognizer', function(done) {
+	var ps = helpers.recognizer(),
+		called = false;
+	ps.on('error', function(err) {
+		assert.strictEqual(err.message, 'Stop the recognizer before replaying a session');
+		assert.strictEqual(called, false);
+		ps.stop();
+		ps.free();
+		done();
+	});
+	ps.start();
+	ps.replay(helpers.tmp('busy.bin'), function() { called = true; });
+});
+
+test('beam changes of adaptive pruning are replayed', function(done) {
+	var file = helpers.tmp('pruning.bin'),
+		ps = helpers.recognizer(),
+		chunks = helpers.chunks(helpers.utterance(), 0.1);
+	ps.adaptivePruning({ target: 1e-9, maxLevel: 2 });
+	ps.record(file);
+	for(var i = 0; i < 2; i++) {
+		ps.start();
+		chunks.forEach(function(chunk) { ps.writeSync(chunk); });
+		ps.stop();
+	}
+	ps.record(false);
+	assert.ok(ps.pruningStats().level > 0);
+	ps.free();
+
+	// Without a pruning controller, the session still runs with the beams it had
+	var other = helpers.recognizer();
+	other.on('error', done);
+	other.replay(file, function(err, result) {
+		assert.ifError(err);
+		assert.ok(result.pruning >= 1, 'pruning ' + result.pruning);
+		assert.strictEqual(other.pruningStats().level, 0);
+		other.free();
+		done();
+	});
+});
+
+test('realtime replays keep the recorded gaps', function(done) {
+	var file = helpers.tmp('realtime.bin'),
+		ps = helpers.recognizer();
+	ps.record(file);
+	ps.start();
+	setTimeout(function() {
+		ps.stop();
+		ps.record(false);
+
+		ps.replay(file, { realtime: true }, function(err, result) {
+			assert.ifError(err);
+			assert.ok(result.wallDuration >= 80, 'wall ' + result.wallDuration);
+			ps.free();
+			done();
+		});
+	}, 100);
+});
@@ -0,0 +1,61 @@
+var assert = require('assert'),
+	fs = require('fs'),
+	PocketSphinx = require('../'),
+	helpers = require('./helpers');
+
+function read(file) {
+	// Throws on invalid JSON
+	return JSON.parse(fs.readFileSync(file, 'utf8')).traceEvents;
+}
+
+test('spans of one written chunk share its number', function(done) {
+	var file = helpers.tmp('chunks.json'),
+		ps = helpers.recognizer();
+	ps.silenceDetection(false);
+	ps.on('hyp', function() {});
+
+	PocketSphinx.trace({ path: file });
+	ps.start();
+	ps.write(helpers.noise(0.2));
+	ps.write(helpers.noise(0.2));
+	ps.writeSync(helpers.noise(0.2));
+	ps.on('stop', function() {
+		PocketSphinx.trace(false);
+		ps.free();
+
+		// Only this Recognizer decoded while the trace ran
+		var events = read(file);
+		function chunks(name) {
+			return events.filter(function(event) { return event.name === name; }).map(function(event) { return event.args.chunk; });
+		}
+		// writeSync queues behind the pending writes
+		assert.deepStrictEqual(chunks('uv_queue_work'), [1, 2, 3]);
+		assert.deepStrictEqual(chunks('ps_process_raw'), [1, 2, 3]);
+		assert.deepStrictEqual(chunks('ps_get_hyp'), [1, 2, 3]);
+		assert.deepStrictEqual(chunks('hyp'), [1, 2, 3]);
+		// Spans outside of a chunk have no number
+		assert.deepStrictEqual(chunks('ps_start_utt'), [undefined]);
+		done();
+	});
+	ps.stop();
+});
+
+test('the trace file is valid JSON', function(done) {
+	var file = helpers.tmp('valid.json'),
+		ps = helpers.recognizer();
+	PocketSphinx.trace({ path: file });
+	ps.start();
+	ps.writeSync(helpers.noise(0.2));
+	ps.stop();
+	ps.free();
+	PocketSphinx.trace(false);
+
+	var events = read(file);
+	assert.ok(events.length > 0);
+	events.forEach(function(event) {
+		assert.strictEqual(typeof event.name, 'string');
+		assert.strictEqual(typeof event.cat, 'string');
+		assert.strictEqual(event.ph, 'X');
+	});
+	done();
+});
@@ -0,0 +1,59 @@
+var assert = require('assert'),
+	path = require('path'),
+	Worker = require('worker_threads').Worker,
+	helpers = require('./helpers');
+
+// Decodes an utterance, posts the final hypothesis and leaves the Recognizer for the environment cleanup
+var decoder = [
+	'var parentPort = require("worker_threads").parentPort;',
+	'var helpers = require(' + JSON.stringify(path.join(__dirname, 'helpers')) + ');',
+	'var ps = helpers.recognizer();',
+	'ps.silenceDetection(false);',
+	'ps.on("error", function(err) { throw err; });',
+	'ps.on("hypFinal", function(err, hyp) { parentPort.postMessage(hyp); });',
+	'ps.on("stop", function() {',
+	'	ps.start();',
+	'	ps.write(helpers.noise(0.5));',
+	'});',
+	'ps.start();',
+	'ps.write(helpers.utterance());',
+	'ps.stop();'
+].join('\n');
+
+test('recognizers decode in two workers and the main thread at once', function(done) {
+	var hyps = [],
+		exited = 0,
+		ps = helpers.recognizer(),
+		expected;
+	ps.silenceDetection(false);
+	ps.on('error', done);
+	ps.on('hypFinal', function(err, hyp) { expected = hyp; });
+
+	function finished() {
+		if(exited < 2 || expected === undefined)
+			return;
+		// Every environment has its own addon state, the workers decode like the main thread
+		assert.deepStrictEqual(hyps, [expected, expected]);
+		ps.free();
+		done();
+	}
+
+	for(var i = 0; i < 2; i++) {
+		var worker = new Worker(decoder, { eval: true });
+		worker.on('error', done);
+		worker.on('message', function(hyp) {
+			hyps.push(hyp);
+			// Terminated with a write still queued and the Recognizer never freed
+			this.terminate();
+		});
+		worker.on('exit', function() {
+			exited++;
+			finished();
+		});
+	}
+
+	ps.start();
+	ps.write(helpers.utterance());
+	ps.stop();
+	ps.on('stop', finished);
+});
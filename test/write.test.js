@@ -0,0 +1,98 @@
+var assert = require('assert'),
+	PocketSphinx = require('../'),
+	helpers = require('./helpers');
+
+test('stop waits for the writes queued before it', function(done) {
+	var ps = helpers.recognizer(),
+		log = helpers.events(ps, ['start', 'hyp', 'error']);
+	ps.silenceDetection(false);
+
+	ps.on('stop', function() {
+		var names = log.map(function(event) { return event.name; });
+		assert.deepStrictEqual(names, ['start', 'hyp', 'hyp', 'hyp']);
+		ps.free();
+		done();
+	});
+
+	ps.start();
+	for(var i = 0; i < 3; i++) {
+		ps.write(helpers.noise(0.5));
+	}
+	ps.stop();
+});
+
+test('writes after stop are skipped', function(done) {
+	var ps = helpers.recognizer(),
+		hyps = 0;
+	ps.silenceDetection(false);
+	ps.on('hyp', function() { hyps++; });
+	ps.on('error', done);
+
+	ps.start();
+	ps.write(helpers.noise(0.2));
+	ps.stop();
+	ps.write(helpers.noise(0.2));
+	ps.restart();
+	ps.write(helpers.noise(0.2));
+	ps.stop();
+
+	var stops = 0;
+	ps.on('stop', function() {
+		if(++stops === 2) {
+			assert.strictEqual(hyps, 2);
+			ps.free();
+			done();
+		}
+	});
+});
+
+test('writeSync queues behind pending writes', function(done) {
+	var ps = helpers.recognizer(),
+		order = [];
+	ps.silenceDetection(false);
+	ps.on('hyp', function() { order.push('hyp'); });
+	ps.on('stop', function() {
+		assert.deepStrictEqual(order, ['hyp', 'hyp']);
+		ps.free();
+		done();
+	});
+
+	ps.start();
+	ps.write(helpers.noise(0.5));
+	// Would run next to the pending write otherwise
+	ps.writeSync(helpers.noise(0.5));
+	assert.deepStrictEqual(order, []);
+	ps.stop();
+});
+
+test('jobPool limits the pending writes', function(done) {
+	var defaults = PocketSphinx.jobPool();
+	var stats = PocketSphinx.jobPool(defaults.capacity, 2);
+	assert.strictEqual(stats.limit, 2);
+
+	var ps = helpers.recognizer(),
+		errors = 0;
+	ps.silenceDetection(false);
+	ps.on('error', function(err) {
+		assert.ok(/Too many writes pending/.test(err.message));
+		errors++;
+	});
+
+	ps.start();
+	for(var i = 0; i < 5; i++) {
+		ps.write(helpers.noise(0.1));
+	}
+	assert.strictEqual(errors, 3);
+	assert.strictEqual(PocketSphinx.jobPool().active, 2);
+
+	// Control calls are never refused, otherwise a full queue could not be stopped
+	ps.on('stop', function() {
+		// The stop job itself is released once its handler returned
+		setImmediate(function() {
+			assert.strictEqual(PocketSphinx.jobPool(defaults.capacity, defaults.limit).active, 0);
+			ps.free();
+			done();
+		});
+	});
+	ps.stop();
+});